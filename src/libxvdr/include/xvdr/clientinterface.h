@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "xvdr/dataset.h"
 #include "xvdr/thread.h"
@@ -104,6 +105,23 @@ public:
 
   virtual void TransferChannelGroupMember(const ChannelGroupMember& member) = 0;
 
+  // batch transfer of a whole response, passed on item by item by default
+
+  virtual void TransferChannelEntries(const std::vector<const Channel*>& channels);
+
+  virtual void TransferTimerEntries(const std::vector<const Timer*>& timers);
+
+  // entries of the local guide and recording index, all of a request at once.
+  // passed on item by item by default, as copies unless the items are overridden
+
+  virtual void TransferEpgEntries(const std::vector<EpgItemRef>& tags);
+
+  virtual void TransferRecordingEntries(const std::vector<RecordingEntryRef>& recs);
+
+  virtual void TransferEpgEntryRef(const EpgItemRef& tag);
+
+  virtual void TransferRecordingEntryRef(const RecordingEntryRef& rec);
+
   // packet allocation
 
   virtual Packet* AllocatePacket(int length) = 0;
@@ -29,6 +29,8 @@
 
 #include <string>
 #include <map>
+#include <deque>
+#include <set>
 #include <vector>
 
 #include "xvdr/dataset.h"
@@ -38,6 +40,14 @@ class MsgPacket;
 namespace XVDR {
 
 class ClientInterface;
+class EpgPrefetch;
+class EpgStore;
+class RecordingCache;
+class RecordingIndex;
+class RecordingStripe;
+class ResponseCache;
+class ResponseDecoder;
+class Worker;
 
 class Connection : public Session, public Thread
 {
@@ -59,15 +69,25 @@ public:
   const std::string& GetVersion()    { return m_version; }
 
   bool        EnableStatusInterface(bool onOff);
+  void        SetUpdateDelay(int delay_ms);
+  void        GetUpdateStats(uint64_t* notifications, uint64_t* updates);
   bool        SetUpdateChannels(uint8_t method);
   bool        ChannelFilter(bool fta, bool nativelangonly, std::vector<int>& caids);
 
   bool        SupportChannelScan();
   bool        GetDriveSpace(long long *total, long long *used);
 
+  bool        SyncClock();
+  int64_t     GetClockOffset();
+  int64_t     GetServerTime();
+
   int         GetChannelsCount();
   bool        GetChannelsList(bool radio = false);
   bool        GetEPGForChannel(uint32_t channeluid, time_t start, time_t end);
+  bool        SetEpgStore(const std::string& folder, int maxage = 4 * 3600);
+  void        SetEpgPrefetch(int hours, int interval_ms = 2000);
+  void        ChannelWatched(uint32_t channeluid);
+  bool        SetChannelCache(const std::string& filename);
 
   int         GetChannelGroupCount(bool automatic);
   bool        GetChannelGroupList(bool bRadio);
@@ -82,6 +102,7 @@ public:
 
   int         GetRecordingsCount();
   bool        GetRecordingsList();
+  bool        SetRecordingIndex(const std::string& filename);
   bool        RenameRecording(const std::string& recid, const std::string& newname);
   int         DeleteRecording(const std::string& recid);
   bool        SetRecordingPlayCount(const std::string& recid, int count);
@@ -90,6 +111,10 @@ public:
 
   MsgPacket*  ReadResult(MsgPacket* vrp);
 
+  bool        SendRequest(MsgPacket* vrp, MsgPacket* buffer = NULL);
+  MsgPacket*  ReceiveResult(MsgPacket* vrp, bool wait = true);
+  void        CancelRequest(MsgPacket* vrp);
+
   // Recordings
 
   bool OpenRecording(const std::string& recid);
@@ -99,6 +124,16 @@ public:
   long long SeekRecording(long long pos, uint32_t whence);
   long long RecordingPosition(void);
   long long RecordingLength(void);
+  uint32_t RecordingFrames(void);
+  int RecordingFrame(void);
+  long long SeekRecordingFrame(uint32_t frame);
+  long long SeekRecordingTime(int ms, double fps = 25.0);
+  bool SetRecordingSpeed(int speed);
+  void SetRecordingPrefetch(int blocks);
+  bool SetRecordingCache(size_t size, const std::string& spillfile = "", size_t spillsize = 0);
+  void GetRecordingCacheStats(uint64_t* hits, uint64_t* misses);
+  void SetRecordingStripes(int sessions);
+  bool DownloadRecording(const std::string& recid, const std::string& filename, int sessions = 4);
   bool LoadRecordingEdl(const std::string& recid, RecordingEdl& edl);
 
   // Channelscanner
@@ -115,25 +150,107 @@ protected:
   virtual void Action(void);
   virtual bool OnResponsePacket(MsgPacket *pkt);
   virtual bool TryReconnect();
+  virtual MsgPacket* ReceiveBuffer(MsgPacket* header);
+  virtual uint32_t ReceivePartSize(MsgPacket* header);
+  virtual void ReceivePart(MsgPacket* header, MsgPacket* part);
 
   void SignalConnectionLost();
   void OnDisconnect();
   void OnReconnect();
 
+  // sample the server clock now and then while streaming
+  void KeepClockSynced(bool on);
+
   bool m_statusinterface;
   ClientInterface* m_client;
 
 private:
 
+  friend class EpgPrefetch;
+  friend class Worker;
+
+  enum
+  {
+    TASK_RECORDINGS = 0x01,
+    TASK_EDLS       = 0x02,
+    TASK_POSITIONS  = 0x04,
+    TASK_FLUSH      = 0x08,
+    TASK_CHANNELS   = 0x10,
+    TASK_SAVE       = 0x20,
+    TASK_TIMERS     = 0x40,
+    TASK_CLOCK      = 0x80
+  };
+
+  void        ScheduleTasks(int tasks, int delay_ms = 0);
+  void        RunTasks(int tasks);
+
   bool        Login();
+  bool        QueueRequest(MsgPacket* vrp, MsgPacket* buffer, bool parts);
+  MsgPacket*  ReceivePart(MsgPacket* vrp, bool& last);
+  bool        ReadStream(MsgPacket* vrp, ResponseDecoder& decoder);
+  MsgPacket*  ReadCached(ResponseCache* cache, MsgPacket* vrp, bool* cached = NULL);
+  MsgPacket*  ReadChannelGroups(MsgPacket* vrp);
+  int         RefreshCache(ResponseCache* cache);
+  void        SaveChannelCache();
+  MsgPacket*  ReadTimers();
+  void        ScheduleUpdate(int tasks);
+  int         RefreshRecordingIndex();
+  bool        Idle(int ms);
+  bool        FetchEpg(Session* session, uint32_t channeluid, uint32_t start, uint32_t end);
+  bool        ReadRecordingEdl(MsgPacket* vresp, RecordingEdl& edl);
+  void        PrefetchRecordingEdls();
+  void        PrefetchRecordingPositions();
+  void        FlushRecordingState();
+  void        TransmitPipelined(std::vector<MsgPacket*>& requests, std::vector<MsgPacket*>& responses, size_t window);
+
+  bool        RecordingLengthExpired();
+  bool        UpdateRecordingLength();
+  struct RecordingRequest
+  {
+    uint64_t position;
+    RecordingStripe* stripe;
+    MsgPacket* request;
+  };
+
+  bool        RequestRecordingBlock(uint64_t position, RecordingRequest& r);
+  bool        FetchRecordingBlock(uint64_t position);
+  void        PrefetchRecording();
+  void        CancelRecordingPrefetch();
+  bool        GetRecordingIFrame(uint32_t frame, bool forward, uint32_t& number, uint64_t& position, uint32_t& length);
+  bool        LookupRecordingIFrame(uint32_t frame, bool forward, uint32_t& number, uint64_t& position, uint32_t& length);
+  bool        StoreRecordingIFrame(uint32_t frame, bool forward, MsgPacket* vresp, uint32_t& number, uint64_t& position, uint32_t& length);
+  int         FrameAtPosition(uint64_t position);
+  long long   SetRecordingPosition(uint64_t position);
+  struct TrickPlayFrame
+  {
+    uint32_t target;
+    MsgPacket* lookup;
+    MsgPacket* request;
+    uint64_t position;
+    uint32_t length;
+    uint32_t number;
+  };
+  bool        StartTrickPlay();
+  bool        RequestTrickPlayFrame(TrickPlayFrame& f);
+  void        ResolveTrickPlayFrame(TrickPlayFrame& f, MsgPacket* vresp);
+  void        PrefetchTrickPlay();
+  void        CancelTrickPlay();
+  int         ReadTrickPlay(unsigned char* buf, uint32_t buf_size);
+  void        OpenRecordingStripes();
+  void        CloseRecordingStripes();
 
   struct SMessage
   {
     CondWait* event;
     MsgPacket* pkt;
+    MsgPacket* buffer;
+    bool parts;
+    bool failed;
+    std::deque<MsgPacket*> received;
   };
   typedef std::map<int, SMessage> SMessages;
   SMessages m_queue;
+  uint64_t m_lastrequest;
 
   Mutex m_mutex;
   Mutex m_cmdlock;
@@ -149,6 +266,69 @@ private:
   uint64_t m_currentPlayingRecordBytes;
   uint64_t m_currentPlayingRecordPosition;
 
+  std::deque<RecordingRequest> m_recrequests;
+  RecordingCache* m_reccache;
+  int m_recprefetch;
+  uint64_t m_recprefetchpos;
+  uint64_t m_recnextpos;
+  int m_recsequential;
+  bool m_recgrowing;
+  bool m_recprobe;
+  uint64_t m_rechits;
+  uint64_t m_recmisses;
+  int m_recstripes;
+  std::vector<RecordingStripe*> m_recsessions;
+
+  // I-frames of the recording, the frames known to resolve to them
+  struct RecordingIFrame
+  {
+    uint64_t position;
+    uint32_t length;
+    uint32_t first;
+    uint32_t last;
+  };
+  std::map<uint32_t, RecordingIFrame> m_reciframes;
+  std::map<uint64_t, uint32_t> m_recframepositions;
+  uint32_t m_recframes;
+
+  EpgStore* m_epgstore;
+  EpgPrefetch* m_epgprefetch;
+
+  ResponseCache* m_channelcache;
+  std::string m_channelcachefile;
+  bool m_groupsautomatic;
+  bool m_groupscounted;
+  ResponseCache* m_timercache;
+
+  int m_updatedelay;
+  uint64_t m_notifications;
+  uint64_t m_updates;
+
+  RecordingIndex* m_recindex;
+  std::string m_recindexfile;
+  Worker* m_worker;
+
+  std::map<std::string, RecordingEdl> m_recedls;
+  Mutex m_recedllock;
+
+  // resume points and play counts, changes are written back in batches
+  std::map<std::string, int64_t> m_recpositions;
+  std::map<std::string, int64_t> m_recdirtypositions;
+  std::map<std::string, int> m_recdirtyplaycounts;
+  int m_recstateattempts;
+  Mutex m_recstatelock;
+
+  // I-frames on their way in trick-play mode
+  std::deque<TrickPlayFrame> m_rectrick;
+  int m_recspeed;
+  int64_t m_rectricktarget;
+  int64_t m_rectricklast;
+  MsgPacket* m_rectrickframe;
+  uint32_t m_rectrickoffset;
+  TimeMs m_recupdate;
+  std::set<std::string> m_activerecordings;
+  std::string m_recname;
+
   std::string m_server;
   std::string m_version;
   std::string m_name;
@@ -156,6 +336,11 @@ private:
   int m_compressionlevel;
   int m_audiotype;
   int m_protocol;
+
+  bool m_clockvalid;
+  bool m_clocksync;
+  int64_t m_clocklow;
+  int64_t m_clockhigh;
 };
 
 } // namespace XVDR
@@ -52,6 +52,31 @@ public:
 };
 
 EpgItem& operator<< (EpgItem& lhs, MsgPacket* rhs);
+MsgPacket& operator<< (MsgPacket& lhs, const EpgItem& rhs);
+
+
+/**
+ * An event of the local guide, the strings are held by the library and
+ * only valid while it is passed to the client.
+ */
+class EpgItemRef {
+public:
+
+  EpgItemRef();
+
+  uint32_t    UID;
+  uint32_t    BroadcastID;
+  uint32_t    StartTime;
+  uint32_t    EndTime;
+  uint8_t     GenreType;
+  uint8_t     GenreSubType;
+  uint32_t    ParentalRating;
+  const char* Title;
+  const char* PlotOutline;
+  const char* Plot;
+};
+
+EpgItem& operator<< (EpgItem& lhs, const EpgItemRef& rhs);
 
 
 class Channel {
@@ -123,6 +148,36 @@ public:
 };
 
 RecordingEntry& operator<< (RecordingEntry& lhs, MsgPacket* rhs);
+MsgPacket& operator<< (MsgPacket& lhs, const RecordingEntry& rhs);
+
+
+/**
+ * A recording of the local index, the strings are held by the library and
+ * only valid while it is passed to the client.
+ */
+class RecordingEntryRef {
+public:
+
+  RecordingEntryRef();
+
+  uint32_t    Time;
+  uint32_t    Duration;
+  uint8_t     Priority;
+  uint8_t     LifeTime;
+  const char* ChannelName;
+  const char* Title;
+  const char* PlotOutline;
+  const char* Plot;
+  const char* Directory;
+  const char* Id;
+  uint8_t     GenreType;
+  uint8_t     GenreSubType;
+  uint8_t     PlayCount;
+  const char* ThumbNailPath;
+  const char* IconPath;
+};
+
+RecordingEntry& operator<< (RecordingEntry& lhs, const RecordingEntryRef& rhs);
 
 
 class RecordingCutMark {
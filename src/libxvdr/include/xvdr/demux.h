@@ -53,6 +53,14 @@ public:
     SC_INVALID_CHANNEL = XVDR_RET_DATAINVALID       /* !< invalid channel */
   } SwitchStatus;
 
+  // stream filter flags
+  typedef enum {
+    SF_NONE = 0,                                    /* !< pass all streams */
+    SF_PREFERRED_AUDIO = 1,                         /* !< pass audio streams in the preferred language only */
+    SF_NO_SUBTITLES = 2,                            /* !< drop DVB subtitle streams */
+    SF_NO_TELETEXT = 4                              /* !< drop teletext streams */
+  } StreamFilter;
+
 public:
 
   Demux(ClientInterface* client, PacketBuffer* buffer);
@@ -63,6 +71,8 @@ public:
 
   void Abort();
 
+  void Interrupt();
+
   Packet* Read();
 
   template<class T>T* Read() {
@@ -72,6 +82,12 @@ public:
   SwitchStatus SwitchChannel(uint32_t channeluid);
   void SetPriority(int priority);
   void SetStartWithIFrame(bool on);
+  void SetRequestWindow(int packets);
+  void SetStreamFilter(int filter);
+  void SetCatchUp(int ms);
+
+  // how far playback is behind the live edge of the server (ms)
+  int GetLiveLatency();
 
   StreamProperties GetStreamProperties();
   SignalStatus GetSignalStatus();
@@ -99,21 +115,48 @@ private:
 
   void GetContentFromType(const std::string& type, std::string& content);
 
+  void ParseStreams(MsgPacket *resp, StreamProperties& streams);
+
+  bool StreamSelected(uint32_t physicalid);
+
+  void ClassifyFrame(MsgPacket *resp, uint32_t physicalid);
+
   void CleanupPacketQueue();
 
+  bool RequestPackets();
+
+  void LivePacket(int64_t pts, int64_t servertime);
+
+  int LiveLatency(int64_t servertime);
+
+  struct QueuedPacket {
+    Packet* packet;
+    int64_t pts;
+  };
+
   StreamProperties m_streams;
   SignalStatus m_signal;
   int m_priority;
   uint32_t m_channeluid;
-  std::queue<Packet*> m_queue;
+  std::queue<QueuedPacket> m_queue;
   PacketBuffer* m_buffer;
   Mutex m_lock;
   CondWait m_cond;
   bool m_queuelocked;
+  bool m_interrupted;
   bool m_paused;
   bool m_timeshiftmode;
   TimeMs m_lastsignal;
   bool m_iframestart;
+  int m_requested;
+  int m_requestwindow;
+  int m_filter;
+  std::string m_language;
+  StreamProperties m_livestreams;
+  int m_catchup;
+  bool m_livevalid;
+  int64_t m_liveorigin;
+  int64_t m_readpts;
 };
 
 } // namespace XVDR
@@ -0,0 +1,81 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_FRAMEPARSER_H
+#define XVDR_FRAMEPARSER_H
+
+#include <stdint.h>
+#include <string>
+
+namespace XVDR {
+
+/**
+ * Elementary stream scanner used to classify video frames on the client.
+ */
+class FrameParser {
+public:
+
+  typedef enum {
+    FT_UNKNOWN = 0,
+    FT_IFRAME = 1,
+    FT_PFRAME = 2,
+    FT_BFRAME = 3
+  } FrameType;
+
+  typedef enum {
+    CODEC_UNKNOWN = 0,
+    CODEC_MPEG2 = 1,
+    CODEC_H264 = 2,
+    CODEC_HEVC = 3
+  } Codec;
+
+  /**
+   * Map a stream type (as announced in a stream change) to a codec.
+   */
+  static Codec GetCodec(const std::string& type);
+
+  /**
+   * Find the next start code prefix (00 00 01).
+   * Uses SSE2 or NEON if available.
+   *
+   * @return pointer to the byte following the prefix or NULL if none was found.
+   */
+  static const uint8_t* FindStartCode(const uint8_t* data, const uint8_t* end);
+
+  /**
+   * Portable version of FindStartCode().
+   */
+  static const uint8_t* FindStartCodeScalar(const uint8_t* data, const uint8_t* end);
+
+  /**
+   * Get the type of the first picture / slice in a video packet.
+   */
+  static FrameType GetFrameType(Codec codec, const uint8_t* data, int length);
+
+};
+
+} // namespace XVDR
+
+#endif // XVDR_FRAMEPARSER_H
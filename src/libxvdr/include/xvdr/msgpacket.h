@@ -339,6 +339,15 @@ public:
 	*/
 	uint32_t getPayloadLength();
 
+	/**
+	Get announced payload length.
+	Return the payload size written in the header. Differs from getPayloadLength()
+	for a received header whose payload hasn't been read (yet).
+
+	@return payload size from the header
+	*/
+	uint32_t getHeaderPayloadLength();
+
 	/**
 	Get unique message id.
 	Returns the unique message id of the packet
@@ -468,6 +477,37 @@ public:
 	*/
 	static MsgPacket* read(int fd, bool& closed, int timeout_ms = 3000);
 
+	/**
+	Receive packet header from socket.
+	Create a new packet from the incoming header, the payload has to be
+	received with readpayload().
+
+	@param	fd			filedescriptor of the socket
+	@param	closed		set to true if connection has been closed
+	@param	timeout_ms	read operation timeout in milliseconds
+	@return pointer to new packet or NULL on timeout
+	*/
+	static MsgPacket* readheader(int fd, bool& closed, int timeout_ms = 3000);
+
+	/**
+	Receive packet payload from socket.
+	Reads the payload announced by the header into the packet and verifies it.
+
+	@param	fd			filedescriptor of the socket
+	@param	timeout_ms	read operation timeout in milliseconds
+	@return true on success
+	*/
+	bool readpayload(int fd, int timeout_ms = 3000);
+
+	/**
+	Reuse packet memory.
+	Take over the header of another packet and drop the payload. The allocated
+	memory is kept, so receiving into a reused packet doesn't reallocate.
+
+	@param	header	packet to copy the header from
+	*/
+	void reuse(MsgPacket* header);
+
 	static bool readstream(std::istream& in, MsgPacket& p);
 
 	enum {
@@ -484,6 +524,16 @@ public:
 		SyncPos = 0								/*!< sync-mark position (uint32_t). */
 	};
 
+	/**
+	Compute a CRC32 checksum.
+
+	@param  buf		pointer to data array
+	@param  size    size of array in bytes
+	@param  crc     checksum of the preceding data (to continue a checksum)
+	@return 32bit crc
+	*/
+	static uint32_t crc32(const uint8_t* buf, int size, uint32_t crc = 0);
+
 protected:
 
 	void Init(uint16_t msgid, uint16_t type = 0, uint32_t uid = 0);
@@ -496,15 +546,6 @@ protected:
 	*/
 	void setUID(uint32_t uid);
 
-	/**
-	Compute a CRC32 checksum.
-
-	@param  buf		pointer to data array
-	@param  size    size of array in bytes
-	@return 32bit crc
-	*/
-	static uint32_t crc32(const uint8_t* buf, int size);
-
 	static int read(int fd, uint8_t* data, int datalen, int timeout_ms);
 
 private:
@@ -32,6 +32,7 @@ class MsgPacket;
 namespace XVDR {
 
 class Callbacks;
+class ResponseDecoder;
 
 class Session
 {
@@ -53,6 +54,10 @@ public:
 
   MsgPacket* ReadResult(MsgPacket* vrp);
 
+  // sends a request, the items of the response are passed to decoder while
+  // they arrive
+  virtual bool ReadStream(MsgPacket* vrp, ResponseDecoder& decoder);
+
   bool ConnectionLost();
 
 protected:
@@ -67,6 +72,16 @@ protected:
 
   virtual void SignalConnectionLost();
 
+  virtual MsgPacket* ReceiveBuffer(MsgPacket* header);
+
+  // size of the parts to receive a payload in, 0 to receive it as a whole
+  virtual uint32_t ReceivePartSize(MsgPacket* header);
+
+  // takes over a part of the (uncompressed) payload, the header is returned by
+  // ReadMessage() at the end. NULL if the response turned out to be broken,
+  // the parts passed so far must be dropped.
+  virtual void ReceivePart(MsgPacket* header, MsgPacket* part);
+
   std::string m_hostname;
 
   int m_port;
@@ -81,8 +96,16 @@ private:
 
   bool readData(uint8_t* buffer, int totalBytes);
 
+  bool ReadPayloadParts(MsgPacket* header, uint32_t partsize);
+
+  bool ReadParts(MsgPacket* header, uint32_t partsize, uint32_t& checksum);
+
+  bool ReadCompressedParts(MsgPacket* header, uint32_t partsize, uint32_t& checksum);
+
   int m_fd;
 
+  ResponseDecoder* m_decoder;
+
   /*struct streamPacketHeader;
 
   struct streamPacketHeader* m_streamPacketHeader;
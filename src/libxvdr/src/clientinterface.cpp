@@ -113,6 +113,44 @@ void ClientInterface::OnChannelScannerStatus(const ChannelScannerStatus& status)
   Log(INFO, "Scanner: %i%% done (%i new channels)", status.progress, status.newChannels);
 }
 
+void ClientInterface::TransferChannelEntries(const std::vector<const Channel*>& channels) {
+  for(std::vector<const Channel*>::const_iterator i = channels.begin(); i != channels.end(); i++) {
+    TransferChannelEntry(**i);
+  }
+}
+
+void ClientInterface::TransferTimerEntries(const std::vector<const Timer*>& timers) {
+  for(std::vector<const Timer*>::const_iterator i = timers.begin(); i != timers.end(); i++) {
+    TransferTimerEntry(**i);
+  }
+}
+
+void ClientInterface::TransferEpgEntries(const std::vector<EpgItemRef>& tags) {
+  for(std::vector<EpgItemRef>::const_iterator i = tags.begin(); i != tags.end(); i++) {
+    TransferEpgEntryRef(*i);
+  }
+}
+
+void ClientInterface::TransferRecordingEntries(const std::vector<RecordingEntryRef>& recs) {
+  for(std::vector<RecordingEntryRef>::const_iterator i = recs.begin(); i != recs.end(); i++) {
+    TransferRecordingEntryRef(*i);
+  }
+}
+
+void ClientInterface::TransferEpgEntryRef(const EpgItemRef& tag) {
+  EpgItem item;
+  item << tag;
+
+  TransferEpgEntry(item);
+}
+
+void ClientInterface::TransferRecordingEntryRef(const RecordingEntryRef& rec) {
+  RecordingEntry entry;
+  entry << rec;
+
+  TransferRecordingEntry(entry);
+}
+
 void ClientInterface::Lock() {
   m_mutex.Lock();
 }
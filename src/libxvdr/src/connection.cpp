@@ -23,9 +23,12 @@
  *
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <algorithm>
+#include <deque>
 
 #include "xvdr/connection.h"
 #include "xvdr/clientinterface.h"
@@ -33,28 +36,194 @@
 #include "xvdr/command.h"
 
 #include "iso639.h"
+#include "epgprefetch.h"
+#include "epgstore.h"
+#include "recordingcache.h"
+#include "recordingindex.h"
+#include "recordingstripe.h"
+#include "responsecache.h"
+#include "responsedecoder.h"
+#include "worker.h"
 
 using namespace XVDR;
 
 #define SEEK_POSSIBLE 0x10 // flag used to check if protocol allows seeks
+#define TRICKPLAY_GOP 12 // frames skipped per speed step (typical DVB GOP)
+#define TRICKPLAY_PREFETCH 4 // I-frames kept in flight in trick-play mode
+#define EDL_PREFETCH 16 // cut mark requests kept in flight while filling the cache
+#define STATE_PREFETCH 32 // position requests kept in flight while filling the cache
+#define STATE_FLUSHDELAY 2000 // ms to collect resume points and play counts before writing them
+#define STATE_ATTEMPTS 3 // flushes a resume point or play count is tried in before it is dropped
+#define STREAM_PARTSIZE (64 * 1024) // list responses are decoded in parts of this size while they arrive
+#define CACHE_PREFETCH 8 // cached requests kept in flight while verifying the cache
+#define UPDATE_DELAY 500 // default ms to collect change notifications before updating
+#define RECORDING_PROBE 10000 // ms after opening a recording to check if it is still growing
+#define CLOCK_INTERVAL 30000 // ms between samples of the server clock while streaming
+#define DOWNLOAD_PREFETCH 8 // blocks kept in flight per session while downloading a recording
+
+// decoders for list responses received in parts,
+// the layouts must match the operator<< of the items in dataset.cpp
+
+class ChannelDecoder : public ResponseDecoder
+{
+public:
+
+  ChannelDecoder(ClientInterface* client, bool radio, std::string* payload = NULL)
+    : ResponseDecoder("USUUSS"), m_client(client), m_radio(radio), m_payload(payload)
+  {
+  }
+
+protected:
+
+  void Decode(MsgPacket* items)
+  {
+    // collect the payload for the cache
+    if (m_payload != NULL)
+      m_payload->append((const char*)items->getPayload(), items->getPayloadLength());
+
+    // decoded in place, a deque doesn't move them while growing
+    std::deque<Channel> channels;
+    std::vector<const Channel*> tags;
+
+    while (!items->eop())
+    {
+      channels.push_back(Channel());
+      channels.back() << items;
+      channels.back().IsRadio = m_radio;
+      tags.push_back(&channels.back());
+    }
+
+    m_client->TransferChannelEntries(tags);
+  }
+
+private:
+
+  ClientInterface* m_client;
+  bool m_radio;
+  std::string* m_payload;
+};
+
+class EpgDecoder : public ResponseDecoder
+{
+public:
+
+  EpgDecoder(EpgStore* store) : ResponseDecoder("UUUUUSSS"), m_store(store)
+  {
+  }
+
+  ~EpgDecoder()
+  {
+    // the events of a broken response
+    m_store->Release(events);
+  }
+
+  // kept until the whole response is checked
+  EpgStore::Batch events;
+
+protected:
+
+  void Decode(MsgPacket* items)
+  {
+    m_store->Read(items, events);
+  }
+
+private:
+
+  EpgStore* m_store;
+};
+
+class RecordingDecoder : public ResponseDecoder
+{
+public:
+
+  RecordingDecoder(RecordingIndex* index) : ResponseDecoder("UUUUSSSSSSUUSS"), m_index(index)
+  {
+  }
+
+  ~RecordingDecoder()
+  {
+    // the strings of entries not taken by the index
+    m_index->Release(entries);
+  }
+
+  RecordingIndex::Entries entries;
+
+protected:
+
+  void Decode(MsgPacket* items)
+  {
+    m_index->Read(items, entries);
+  }
+
+private:
+
+  RecordingIndex* m_index;
+};
 
 Connection::Connection(ClientInterface* client)
  : m_statusinterface(false)
+ , m_lastrequest(0)
  , m_aborting(false)
  , m_timercount(0)
  , m_updatechannels(2)
+ , m_reccache(new RecordingCache)
+ , m_recprefetch(8)
+ , m_recprefetchpos(0)
+ , m_recnextpos(0)
+ , m_recsequential(0)
+ , m_recgrowing(false)
+ , m_recprobe(false)
+ , m_rechits(0)
+ , m_recmisses(0)
+ , m_recstripes(1)
+ , m_recframes(0)
+ , m_epgstore(new EpgStore)
+ , m_epgprefetch(NULL)
+ , m_channelcache(new ResponseCache(XVDR_CHANNELS_GETCHANNELS))
+ , m_groupsautomatic(false)
+ , m_groupscounted(false)
+ , m_timercache(new ResponseCache(XVDR_TIMER_GETLIST))
+ , m_updatedelay(UPDATE_DELAY)
+ , m_notifications(0)
+ , m_updates(0)
+ , m_recindex(new RecordingIndex)
+ , m_worker(NULL)
+ , m_recstateattempts(0)
+ , m_recspeed(0)
+ , m_rectricktarget(0)
+ , m_rectricklast(-1)
+ , m_rectrickframe(NULL)
+ , m_rectrickoffset(0)
  , m_client(client)
  , m_protocol(0)
  , m_compressionlevel(0)
  , m_audiotype(0)
+ , m_clockvalid(false)
+ , m_clocksync(false)
+ , m_clocklow(0)
+ , m_clockhigh(0)
 {
 }
 
 Connection::~Connection()
 {
+  FlushRecordingState();
+  SaveChannelCache();
+
   Abort();
+  delete m_worker;
+  delete m_epgprefetch;
   Cancel(1);
   Close();
+
+  CancelTrickPlay();
+  CancelRecordingPrefetch();
+  CloseRecordingStripes();
+  delete m_reccache;
+  delete m_recindex;
+  delete m_epgstore;
+  delete m_channelcache;
+  delete m_timercache;
 }
 
 bool Connection::Open(const std::string& hostname, const std::string& name)
@@ -112,6 +281,9 @@ bool Connection::Login()
   m_client->Log(INFO, "Logged in at '%u+%i' to '%s' Version: '%s' with protocol version '%u'", vdrTime, vdrTimeOffset, m_server.c_str(), m_version.c_str(), m_protocol);
   m_client->Log(INFO, "Preferred Audio Language: %s", lang);
 
+  // might be another server now
+  m_groupscounted = false;
+
   delete vresp;
   return true;
 }
@@ -146,793 +318,2438 @@ void Connection::OnDisconnect()
 
 void Connection::OnReconnect()
 {
+  // we may have missed change notifications
+  m_recindex->Invalidate();
+  m_timercache->Invalidate();
+
+  if (m_channelcache->Count() > 0)
+    ScheduleTasks(TASK_CHANNELS);
+
+  {
+    MutexLock lock(&m_recedllock);
+    m_recedls.clear();
+  }
+
+  {
+    MutexLock lock(&m_recstatelock);
+    m_recpositions.clear();
+  }
+
   m_client->OnReconnect();
 }
 
-MsgPacket* Connection::ReadResult(MsgPacket* vrp)
+void Connection::ScheduleTasks(int tasks, int delay_ms)
 {
-  if(m_connectionLost)
-	  return Session::ReadResult(vrp);
+  MutexLock lock(&m_mutex);
 
-  m_mutex.Lock();
+  if (m_worker == NULL)
+  {
+    m_worker = new Worker(this);
+    m_worker->Start();
+  }
 
-  SMessage &message(m_queue[vrp->getUID()]);
-  message.event = new CondWait();
-  message.pkt   = NULL;
+  m_worker->Schedule(tasks, delay_ms);
+}
 
-  m_mutex.Unlock();
+void Connection::ScheduleUpdate(int tasks)
+{
+  int delay = 0;
 
-  if(!Session::TransmitMessage(vrp))
   {
-	MutexLock lock(&m_mutex);
-    m_queue.erase(vrp->getUID());
-    return NULL;
+    MutexLock lock(&m_mutex);
+    m_notifications++;
+    delay = m_updatedelay;
   }
 
-  message.event->Wait(m_timeout);
-
-  m_mutex.Lock();
+  // notifications arriving in a burst end up in a single update
+  ScheduleTasks(tasks, delay);
+}
 
-  MsgPacket* vresp = message.pkt;
-  delete message.event;
+void Connection::RunTasks(int tasks)
+{
+  int updates = 0;
 
-  m_queue.erase(vrp->getUID());
+  // compare with the index and the caches first,
+  // tell XBMC only if something really changed
+  if ((tasks & TASK_RECORDINGS) && (!m_recindex->Valid() || RefreshRecordingIndex() > 0))
+  {
+    m_client->TriggerRecordingUpdate();
+    updates++;
+  }
 
-  m_mutex.Unlock();
+  if ((tasks & TASK_CHANNELS) && (m_channelcache->Count() == 0 || RefreshCache(m_channelcache) > 0))
+  {
+    m_client->TriggerChannelUpdate();
+    updates++;
+  }
 
-  if(vresp == NULL)
-    m_client->Log(FAILURE, "Can't get response packet for Message ID: %i", vrp->getMsgID());
+  if (tasks & (TASK_CHANNELS | TASK_SAVE))
+    SaveChannelCache();
 
-  return vresp;
-}
+  if ((tasks & TASK_TIMERS) && (m_timercache->Count() == 0 || RefreshCache(m_timercache) > 0))
+  {
+    m_client->TriggerTimerUpdate();
+    updates++;
+  }
 
-bool Connection::GetDriveSpace(long long *total, long long *used)
-{
-  MutexLock lock(&m_cmdlock);
+  if (updates > 0)
+  {
+    MutexLock lock(&m_mutex);
+    m_updates += updates;
+  }
 
-  MsgPacket vrp(XVDR_RECORDINGS_DISKSIZE);
+  if (tasks & TASK_FLUSH)
+    FlushRecordingState();
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return false;
+  if (tasks & TASK_POSITIONS)
+    PrefetchRecordingPositions();
 
-  uint32_t totalspace    = vresp->get_U32();
-  uint32_t freespace     = vresp->get_U32();
+  if (tasks & TASK_EDLS)
+    PrefetchRecordingEdls();
 
-  *total = totalspace;
-  *used  = (totalspace - freespace);
+  if (tasks & TASK_CLOCK)
+  {
+    SyncClock();
 
-  /* Convert from kBytes to Bytes */
-  *total *= 1024;
-  *used  *= 1024;
+    MutexLock lock(&m_mutex);
 
-  delete vresp;
-  return true;
+    if (m_clocksync)
+      m_worker->Schedule(TASK_CLOCK, CLOCK_INTERVAL);
+  }
 }
 
-bool Connection::SupportChannelScan()
+void Connection::KeepClockSynced(bool on)
 {
-  MsgPacket vrp(XVDR_SCAN_SUPPORTED);
+  {
+    MutexLock lock(&m_mutex);
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return false;
+    if (m_clocksync == on)
+      return;
 
-  uint32_t ret = vresp->get_U32();
-  delete vresp;
-  return ret == XVDR_RET_OK ? true : false;
+    m_clocksync = on;
+  }
+
+  if (on)
+    ScheduleTasks(TASK_CLOCK, CLOCK_INTERVAL);
 }
 
-bool Connection::EnableStatusInterface(bool onOff)
+MsgPacket* Connection::ReadResult(MsgPacket* vrp)
 {
-  MutexLock lock(&m_cmdlock);
+  if(m_connectionLost)
+	  return Session::ReadResult(vrp);
 
-  MsgPacket vrp(XVDR_ENABLESTATUSINTERFACE);
-  vrp.put_U8(onOff);
+  if(!SendRequest(vrp))
+    return NULL;
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return false;
+  MsgPacket* vresp = ReceiveResult(vrp);
 
-  uint32_t ret = vresp->get_U32();
-  delete vresp;
-  if(ret == XVDR_RET_OK)
-  {
-    m_statusinterface = onOff;
-    return true;
-  }
+  if(vresp == NULL)
+    m_client->Log(FAILURE, "Can't get response packet for Message ID: %i", vrp->getMsgID());
 
-  return false;
+  return vresp;
 }
 
-bool Connection::SetUpdateChannels(uint8_t method)
+bool Connection::SendRequest(MsgPacket* vrp, MsgPacket* buffer)
 {
-  MsgPacket vrp(XVDR_UPDATECHANNELS);
-  vrp.put_U8(method);
+  return QueueRequest(vrp, buffer, false);
+}
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
+bool Connection::QueueRequest(MsgPacket* vrp, MsgPacket* buffer, bool parts)
+{
+  if(m_connectionLost)
   {
-    m_client->Log(INFO, "Setting channel update method not supported by server. Consider updating the XVDR server.");
+    delete buffer;
     return false;
   }
 
-  m_client->Log(INFO, "Channel update method set to %i", method);
+  m_mutex.Lock();
 
-  uint32_t ret = vresp->get_U32();
-  delete vresp;
-  if (ret == XVDR_RET_OK)
+  SMessage &message(m_queue[vrp->getUID()]);
+  message.event  = new CondWait();
+  message.pkt    = NULL;
+  message.buffer = buffer;
+  message.parts  = parts;
+  message.failed = false;
+
+  m_lastrequest = TimeMs::Now();
+
+  m_mutex.Unlock();
+
+  if(!Session::TransmitMessage(vrp))
   {
-    m_updatechannels = method;
-    return true;
+    CancelRequest(vrp);
+    return false;
   }
 
-  return false;
+  return true;
 }
 
-bool Connection::ChannelFilter(bool fta, bool nativelangonly, std::vector<int>& caids)
+MsgPacket* Connection::ReceiveResult(MsgPacket* vrp, bool wait)
 {
-  MutexLock lock(&m_cmdlock);
+  m_mutex.Lock();
 
-  std::size_t count = caids.size();
+  SMessages::iterator it = m_queue.find(vrp->getUID());
 
-  MsgPacket vrp(XVDR_CHANNELFILTER);
-  vrp.put_U32(fta);
-  vrp.put_U32(nativelangonly);
-  vrp.put_U32(count);
+  if(it == m_queue.end())
+  {
+    m_mutex.Unlock();
+    return NULL;
+  }
 
-  for(int i = 0; i < count; i++)
-    vrp.put_U32(caids[i]);
+  SMessage &message(it->second);
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
+  if(message.pkt == NULL && wait)
   {
-    m_client->Log(INFO, "Channel filter method not supported by server. Consider updating the XVDR server.");
-    return false;
+    m_mutex.Unlock();
+    message.event->Wait(m_timeout);
+    m_mutex.Lock();
   }
 
-  m_client->Log(INFO, "Channel filter set");
-
-  uint32_t ret = vresp->get_U32();
-  delete vresp;
+  MsgPacket* vresp = message.pkt;
 
-  if (ret == XVDR_RET_OK)
+  // keep the request pending if we just had a look
+  if(vresp != NULL || wait)
   {
-    m_ftachannels = fta;
-    m_nativelang = nativelangonly;
-    m_caids = caids;
-    return true;
+    delete message.event;
+    delete message.buffer;
+    m_queue.erase(it);
   }
 
-  return false;
+  m_mutex.Unlock();
+
+  return vresp;
 }
 
-int Connection::GetChannelsCount()
+MsgPacket* Connection::ReceivePart(MsgPacket* vrp, bool& last)
 {
-  MutexLock lock(&m_cmdlock);
+  MutexLock lock(&m_mutex);
 
-  MsgPacket vrp(XVDR_CHANNELS_GETCOUNT);
+  SMessages::iterator it = m_queue.find(vrp->getUID());
+  last = true;
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return -1;
+  if(it == m_queue.end())
+    return NULL;
 
-  uint32_t count = vresp->get_U32();
+  SMessage &message(it->second);
 
-  delete vresp;
-  return count;
-}
+  // the event may still be signalled by a part that was taken already
+  TimeMs waited;
 
-bool Connection::GetChannelsList(bool radio)
-{
-  MutexLock lock(&m_cmdlock);
+  while(message.received.empty() && message.pkt == NULL && !message.failed && (int)waited.Elapsed() < m_timeout)
+  {
+    m_mutex.Unlock();
+    message.event->Wait(m_timeout - (int)waited.Elapsed());
+    m_mutex.Lock();
+  }
 
-  MsgPacket vrp(XVDR_CHANNELS_GETCHANNELS);
-  vrp.put_U32(radio);
+  if(!message.received.empty())
+  {
+    MsgPacket* part = message.received.front();
+    message.received.pop_front();
+    last = false;
+    return part;
+  }
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return false;
+  // the header (or the whole response if it was small) comes last
+  MsgPacket* vresp = message.pkt;
 
-  while (!vresp->eop())
+  // parts are missing
+  if (message.failed)
   {
-	  Channel tag(vresp);
-	  tag.IsRadio = radio;
-    m_client->TransferChannelEntry(tag);
+    delete vresp;
+    vresp = NULL;
   }
 
-  delete vresp;
-  return true;
+  delete message.event;
+  delete message.buffer;
+  m_queue.erase(it);
+
+  return vresp;
 }
 
-bool Connection::GetEPGForChannel(uint32_t channeluid, time_t start, time_t end)
+bool Connection::ReadStream(MsgPacket* vrp, ResponseDecoder& decoder)
 {
-  MutexLock lock(&m_cmdlock);
+  // don't block other commands while the list is on its way
+  {
+    MutexLock lock(&m_cmdlock);
 
-  MsgPacket vrp(XVDR_EPG_GETFORCHANNEL);
-  vrp.put_U32(channeluid);
-  vrp.put_U32(start);
-  vrp.put_U32(end - start);
+    if (ConnectionLost() || !QueueRequest(vrp, NULL, true))
+      return false;
+  }
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return false;
+  bool last = false;
 
-  while (!vresp->eop())
+  while (!last)
   {
-    EpgItem item(vresp);
-    item.UID = channeluid;
-    m_client->TransferEpgEntry(item);
+    MsgPacket* vresp = ReceivePart(vrp, last);
+
+    if (vresp == NULL)
+    {
+      m_client->Log(FAILURE, "Can't get response packet for Message ID: %i", vrp->getMsgID());
+      CancelRequest(vrp);
+      return false;
+    }
+
+    decoder.Feed(vresp);
+    delete vresp;
   }
 
-  delete vresp;
-  return true;
+  return decoder.Finish();
 }
 
+void Connection::CancelRequest(MsgPacket* vrp)
+{
+  MutexLock lock(&m_mutex);
 
-/** OPCODE's 60 - 69: XVDR network functions for timer access */
+  SMessages::iterator it = m_queue.find(vrp->getUID());
 
-int Connection::GetTimersCount()
-{
-  MutexLock lock(&m_cmdlock);
+  if(it == m_queue.end())
+    return;
 
-  // return caches values on connection loss
-  if(ConnectionLost())
-    return m_timercount;
+  delete it->second.event;
+  delete it->second.pkt;
+  delete it->second.buffer;
 
-  MsgPacket vrp(XVDR_TIMER_GETCOUNT);
+  for(std::deque<MsgPacket*>::iterator i = it->second.received.begin(); i != it->second.received.end(); i++)
+    delete *i;
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return m_timercount;
+  m_queue.erase(it);
+}
 
-  m_timercount = vresp->get_U32();
+MsgPacket* Connection::ReceiveBuffer(MsgPacket* header)
+{
+  if(header->getType() != XVDR_CHANNEL_REQUEST_RESPONSE)
+    return header;
 
-  delete vresp;
-  return m_timercount;
+  MutexLock lock(&m_mutex);
+
+  SMessages::iterator it = m_queue.find(header->getUID());
+
+  if(it == m_queue.end() || it->second.buffer == NULL)
+    return header;
+
+  // receive straight into the buffer supplied with the request
+  MsgPacket* buffer = it->second.buffer;
+  it->second.buffer = NULL;
+
+  buffer->reuse(header);
+  delete header;
+
+  return buffer;
 }
 
-bool Connection::GetTimerInfo(unsigned int timernumber, Timer& tag)
+uint32_t Connection::ReceivePartSize(MsgPacket* header)
 {
-  MutexLock lock(&m_cmdlock);
+  if(header->getType() != XVDR_CHANNEL_REQUEST_RESPONSE || header->getHeaderPayloadLength() <= STREAM_PARTSIZE)
+    return 0;
 
-  MsgPacket vrp(XVDR_TIMER_GET);
-  vrp.put_U32(timernumber);
+  MutexLock lock(&m_mutex);
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
+  SMessages::iterator it = m_queue.find(header->getUID());
+
+  if(it == m_queue.end() || !it->second.parts)
+    return 0;
+
+  return STREAM_PARTSIZE;
+}
+
+void Connection::ReceivePart(MsgPacket* header, MsgPacket* part)
+{
+  MutexLock lock(&m_mutex);
+
+  SMessages::iterator it = m_queue.find(header->getUID());
+
+  // cancelled meanwhile, or failed already
+  if(it == m_queue.end() || it->second.failed)
   {
-    delete vresp;
-    return false;
+    delete part;
+    return;
   }
 
-  uint32_t returnCode = vresp->get_U32();
-  if (returnCode != XVDR_RET_OK)
+  SMessage &message(it->second);
+
+  // broken response, the waiting decoder gives up right away
+  if(part == NULL)
   {
-    delete vresp;
-    if (returnCode == XVDR_RET_DATAUNKNOWN)
-      return false;
-    else if (returnCode == XVDR_RET_ERROR)
-      return false;
-  }
+    for(std::deque<MsgPacket*>::iterator i = message.received.begin(); i != message.received.end(); i++)
+      delete *i;
 
-  tag << vresp;
+    message.received.clear();
+    message.failed = true;
+  }
+  else
+  {
+    // never wait for a slow decoder, the responses to all other requests
+    // would be held up. the parts pile up instead, at worst the whole response.
+    message.received.push_back(part);
+  }
 
-  delete vresp;
-  return true;
+  message.event->Signal();
 }
 
-bool Connection::GetTimersList()
+bool Connection::GetDriveSpace(long long *total, long long *used)
 {
   MutexLock lock(&m_cmdlock);
 
-  MsgPacket vrp(XVDR_TIMER_GETLIST);
+  MsgPacket vrp(XVDR_RECORDINGS_DISKSIZE);
 
   MsgPacket* vresp = ReadResult(&vrp);
   if (!vresp)
-  {
-    delete vresp;
     return false;
-  }
 
-  uint32_t numTimers = vresp->get_U32();
-  if (numTimers > 0)
-  {
-    while (!vresp->eop())
-    {
-      Timer timer(vresp);
-      m_client->TransferTimerEntry(timer);
-    }
-  }
+  uint32_t totalspace    = vresp->get_U32();
+  uint32_t freespace     = vresp->get_U32();
+
+  *total = totalspace;
+  *used  = (totalspace - freespace);
+
+  /* Convert from kBytes to Bytes */
+  *total *= 1024;
+  *used  *= 1024;
+
   delete vresp;
   return true;
 }
 
-bool Connection::AddTimer(const Timer& timer)
+bool Connection::SyncClock()
 {
   MutexLock lock(&m_cmdlock);
 
-  MsgPacket vrp(XVDR_TIMER_ADD);
-  vrp << timer;
+  MsgPacket vrp(XVDR_GETTIME);
 
+  int64_t sent = TimeMs::Now();
   MsgPacket* vresp = ReadResult(&vrp);
+  int64_t received = TimeMs::Now();
+
   if (vresp == NULL || vresp->eop())
   {
     delete vresp;
     return false;
   }
-  uint32_t returnCode = vresp->get_U32();
+
+  int64_t servertime = (int64_t)vresp->get_U32() * 1000;
   delete vresp;
 
-  return (returnCode == XVDR_RET_OK);
+  // the server clock read somewhere between sending the request and receiving
+  // the response and it only reports full seconds. every sample bounds the
+  // offset, intersecting them narrows it down to the shortest round trip.
+  int64_t low = servertime - received;
+  int64_t high = servertime + 1000 - sent;
+
+  MutexLock clocklock(&m_mutex);
+
+  // start over if the clocks have been adjusted
+  if (!m_clockvalid || low > m_clockhigh || high < m_clocklow)
+  {
+    m_clocklow = low;
+    m_clockhigh = high;
+    m_clockvalid = true;
+  }
+  else
+  {
+    m_clocklow = std::max(m_clocklow, low);
+    m_clockhigh = std::min(m_clockhigh, high);
+  }
+
+  m_client->Log(DEBUG, "server clock offset: %lld ms (+/- %lld ms)", (long long)(m_clocklow + m_clockhigh) / 2, (long long)(m_clockhigh - m_clocklow) / 2);
+  return true;
 }
 
-int Connection::DeleteTimer(uint32_t timerindex, bool force)
+int64_t Connection::GetClockOffset()
 {
-  MutexLock lock(&m_cmdlock);
+  MutexLock lock(&m_mutex);
+  return m_clockvalid ? (m_clocklow + m_clockhigh) / 2 : 0;
+}
 
-  MsgPacket vrp(XVDR_TIMER_DELETE);
-  vrp.put_U32(timerindex);
-  vrp.put_U32(force);
+int64_t Connection::GetServerTime()
+{
+  return TimeMs::Now() + GetClockOffset();
+}
+
+bool Connection::SupportChannelScan()
+{
+  MsgPacket vrp(XVDR_SCAN_SUPPORTED);
 
   MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL || vresp->eop())
-  {
-    delete vresp;
+  if (!vresp)
     return false;
-  }
 
-  uint32_t returnCode = vresp->get_U32();
+  uint32_t ret = vresp->get_U32();
   delete vresp;
-
-  return returnCode;
+  return ret == XVDR_RET_OK ? true : false;
 }
 
-bool Connection::UpdateTimer(const Timer& timer)
+bool Connection::EnableStatusInterface(bool onOff)
 {
   MutexLock lock(&m_cmdlock);
 
-  MsgPacket vrp(XVDR_TIMER_UPDATE);
-  vrp << timer;
+  MsgPacket vrp(XVDR_ENABLESTATUSINTERFACE);
+  vrp.put_U8(onOff);
 
   MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL || vresp->eop())
-  {
-    delete vresp;
+  if (!vresp)
     return false;
-  }
 
-  uint32_t returnCode = vresp->get_U32();
+  uint32_t ret = vresp->get_U32();
   delete vresp;
+  if(ret == XVDR_RET_OK)
+  {
+    m_statusinterface = onOff;
+    return true;
+  }
 
-  return (returnCode == XVDR_RET_OK);
+  return false;
 }
 
-int Connection::GetRecordingsCount()
+void Connection::SetUpdateDelay(int delay_ms)
 {
-  MutexLock lock(&m_cmdlock);
+  MutexLock lock(&m_mutex);
+  m_updatedelay = (delay_ms < 0) ? 0 : delay_ms;
+}
 
-  if(ConnectionLost())
-    return 0;
+void Connection::GetUpdateStats(uint64_t* notifications, uint64_t* updates)
+{
+  MutexLock lock(&m_mutex);
 
-  MsgPacket vrp(XVDR_RECORDINGS_GETCOUNT);
+  *notifications = m_notifications;
+  *updates = m_updates;
+}
+
+bool Connection::SetUpdateChannels(uint8_t method)
+{
+  MsgPacket vrp(XVDR_UPDATECHANNELS);
+  vrp.put_U8(method);
 
   MsgPacket* vresp = ReadResult(&vrp);
   if (!vresp)
-    return -1;
+  {
+    m_client->Log(INFO, "Setting channel update method not supported by server. Consider updating the XVDR server.");
+    return false;
+  }
 
-  uint32_t count = vresp->get_U32();
+  m_client->Log(INFO, "Channel update method set to %i", method);
 
+  uint32_t ret = vresp->get_U32();
   delete vresp;
-  return count;
+  if (ret == XVDR_RET_OK)
+  {
+    m_updatechannels = method;
+    return true;
+  }
+
+  return false;
 }
 
-bool Connection::GetRecordingsList()
+bool Connection::ChannelFilter(bool fta, bool nativelangonly, std::vector<int>& caids)
 {
   MutexLock lock(&m_cmdlock);
 
-  if(ConnectionLost())
-    return true;
+  std::size_t count = caids.size();
 
-  MsgPacket vrp(XVDR_RECORDINGS_GETLIST);
+  MsgPacket vrp(XVDR_CHANNELFILTER);
+  vrp.put_U32(fta);
+  vrp.put_U32(nativelangonly);
+  vrp.put_U32(count);
+
+  for(int i = 0; i < count; i++)
+    vrp.put_U32(caids[i]);
 
   MsgPacket* vresp = ReadResult(&vrp);
   if (!vresp)
-    return false;
-
-  while (!vresp->eop())
   {
-	  RecordingEntry rec(vresp);
-    m_client->TransferRecordingEntry(rec);
+    m_client->Log(INFO, "Channel filter method not supported by server. Consider updating the XVDR server.");
+    return false;
   }
 
+  m_client->Log(INFO, "Channel filter set");
+
+  uint32_t ret = vresp->get_U32();
   delete vresp;
 
-  return true;
+  if (ret == XVDR_RET_OK)
+  {
+    // cached channels of another filter are useless
+    m_channelcache->SetContext("filter", std::string((const char*)vrp.getPayload(), vrp.getPayloadLength()));
+
+    m_ftachannels = fta;
+    m_nativelang = nativelangonly;
+    m_caids = caids;
+    return true;
+  }
+
+  return false;
 }
 
-bool Connection::RenameRecording(const std::string& recid, const std::string& newname)
+int Connection::GetChannelsCount()
 {
-  MutexLock lock(&m_cmdlock);
-  m_client->Log(DEBUG, "%s - uid: %s", __FUNCTION__, recid.c_str());
+  MsgPacket vrp(XVDR_CHANNELS_GETCOUNT);
 
-  MsgPacket vrp(XVDR_RECORDINGS_RENAME);
-  vrp.put_String(recid.c_str());
-  vrp.put_String(newname.c_str());
+  MsgPacket* vresp = ReadCached(m_channelcache, &vrp);
+  if (!vresp)
+    return -1;
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL || vresp->eop())
-  {
-    delete vresp;
-    return false;
-  }
+  uint32_t count = vresp->get_U32();
 
-  uint32_t returnCode = vresp->get_U32();
   delete vresp;
-
-  return (returnCode == XVDR_RET_OK);
+  return count;
 }
 
-int Connection::DeleteRecording(const std::string& recid)
+bool Connection::GetChannelsList(bool radio)
 {
-  MutexLock lock(&m_cmdlock);
+  MsgPacket vrp(XVDR_CHANNELS_GETCHANNELS);
+  vrp.put_U32(radio);
 
-  MsgPacket vrp(XVDR_RECORDINGS_DELETE);
-  vrp.put_String(recid.c_str());
+  // without status messages we won't hear about changes
+  MsgPacket* vresp = m_statusinterface ? m_channelcache->Get(&vrp) : NULL;
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL || vresp->eop())
+  if (vresp != NULL)
   {
+    ChannelDecoder decoder(m_client, radio);
+    decoder.Feed(vresp);
     delete vresp;
-    return false;
+
+    return decoder.Finish();
   }
 
-  uint32_t returnCode = vresp->get_U32();
-  delete vresp;
+  std::string payload;
+  ChannelDecoder decoder(m_client, radio, &payload);
 
-  return returnCode;
+  if (!ReadStream(&vrp, decoder))
+    return false;
+
+  if (m_channelcache->Put(&vrp, payload))
+    ScheduleTasks(TASK_SAVE, STATE_FLUSHDELAY);
+
+  return true;
 }
 
-bool Connection::OnResponsePacket(MsgPacket* pkt)
+bool Connection::GetEPGForChannel(uint32_t channeluid, time_t start, time_t end)
 {
-  return false;
+  if (!FetchEpg(this, channeluid, start, end))
+    return false;
+
+  m_epgstore->Transfer(m_client, channeluid, start, end);
+  return true;
 }
 
-void Connection::Action()
+bool Connection::FetchEpg(Session* session, uint32_t channeluid, uint32_t start, uint32_t end)
 {
-  MsgPacket* vresp;
+  // the store isn't locked while the ranges are on their way. if the
+  // prefetcher loads the same channel meanwhile, the last batch wins.
+  std::vector<EpgStore::Range> missing;
+  m_epgstore->GetMissing(channeluid, start, end, missing);
 
-  while (Running())
+  // only fetch what the store doesn't know (or not recently)
+  for (std::vector<EpgStore::Range>::iterator i = missing.begin(); i != missing.end(); i++)
   {
-    // try to reconnect
-    if(ConnectionLost() && !TryReconnect())
-    {
-      CondWait::SleepMs(500);
-      continue;
-   }
+    MsgPacket vrp(XVDR_EPG_GETFORCHANNEL);
+    vrp.put_U32(channeluid);
+    vrp.put_U32(i->first);
+    vrp.put_U32(i->second - i->first);
 
-    // read message
-    vresp = Session::ReadMessage();
+    EpgDecoder decoder(m_epgstore);
 
-    // there wasn't any response
-    if (vresp == NULL)
-      continue;
+    if (!session->ReadStream(&vrp, decoder))
+      return false;
 
-    // CHANNEL_REQUEST_RESPONSE
+    m_epgstore->Commit(channeluid, i->first, i->second, decoder.events);
+  }
+
+  return true;
+}
+
+bool Connection::SetEpgStore(const std::string& folder, int maxage)
+{
+  m_epgstore->SetMaxAge(maxage);
+
+  if (!m_epgstore->SetFolder(folder))
+  {
+    m_client->Log(FAILURE, "%s - unable to create '%s'", __FUNCTION__, folder.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void Connection::SetEpgPrefetch(int hours, int interval_ms)
+{
+  delete m_epgprefetch;
+  m_epgprefetch = NULL;
+
+  if (hours <= 0)
+    return;
+
+  m_epgprefetch = new EpgPrefetch(this, hours, interval_ms);
+  m_epgprefetch->Start();
+}
+
+void Connection::ChannelWatched(uint32_t channeluid)
+{
+  if (m_epgprefetch != NULL)
+    m_epgprefetch->Watched(channeluid);
+}
+
+bool Connection::Idle(int ms)
+{
+  MutexLock lock(&m_mutex);
+  return m_queue.empty() && TimeMs::Now() - m_lastrequest >= (uint64_t)ms;
+}
+
+bool Connection::SetChannelCache(const std::string& filename)
+{
+  m_channelcachefile = filename;
+
+  if (filename.empty() || !m_channelcache->Load(filename))
+    return false;
+
+  m_client->Log(DEBUG, "%s - %i responses loaded from '%s'", __FUNCTION__, m_channelcache->Count(), filename.c_str());
+
+  // verify the stored lists in the background
+  ScheduleTasks(TASK_CHANNELS);
+  return true;
+}
+
+MsgPacket* Connection::ReadCached(ResponseCache* cache, MsgPacket* vrp, bool* cached)
+{
+  // without status messages we won't hear about changes
+  MsgPacket* vresp = m_statusinterface ? cache->Get(vrp) : NULL;
+
+  if (cached != NULL)
+    *cached = (vresp != NULL);
+
+  if (vresp != NULL)
+    return vresp;
+
+  {
+    MutexLock lock(&m_cmdlock);
+    vresp = ReadResult(vrp);
+  }
+
+  // the channel cache is written to disk a little later
+  if (vresp != NULL && cache->Put(vrp, vresp) && cache == m_channelcache)
+    ScheduleTasks(TASK_SAVE, STATE_FLUSHDELAY);
+
+  return vresp;
+}
+
+MsgPacket* Connection::ReadChannelGroups(MsgPacket* vrp)
+{
+  // the server creates the groups when they are counted,
+  // but the count may have come from the cache
+  if (!m_groupscounted && (!m_statusinterface || !m_channelcache->Contains(vrp)))
+  {
+    MsgPacket count(XVDR_CHANNELGROUP_GETCOUNT);
+    count.put_U32(m_groupsautomatic);
+
+    MutexLock lock(&m_cmdlock);
+
+    MsgPacket* vresp = ReadResult(&count);
+    m_groupscounted = (vresp != NULL);
+    delete vresp;
+  }
+
+  return ReadCached(m_channelcache, vrp);
+}
+
+int Connection::RefreshCache(ResponseCache* cache)
+{
+  std::vector<MsgPacket*> requests;
+  std::vector<MsgPacket*> responses;
+
+  // the protocol has no list versions or checksums, so all cached requests
+  // are sent again (in order, group counts come before the group lists).
+  // this costs as much traffic as loading the lists, it only spares XBMC
+  // the reload if nothing changed. a count alone would miss renamed channels.
+  cache->GetRequests(requests);
+  TransmitPipelined(requests, responses, CACHE_PREFETCH);
+
+  int changes = 0;
+
+  for (size_t i = 0; i < requests.size(); i++)
+  {
+    if (responses[i] != NULL && cache->Put(requests[i], responses[i]))
+      changes++;
+
+    delete requests[i];
+    delete responses[i];
+  }
+
+  if (changes > 0)
+    m_client->Log(DEBUG, "%s - %i of %i responses changed", __FUNCTION__, changes, (int)requests.size());
+
+  return changes;
+}
+
+void Connection::SaveChannelCache()
+{
+  if (m_channelcachefile.empty() || !m_channelcache->Dirty())
+    return;
+
+  if (!m_channelcache->Save(m_channelcachefile))
+    m_client->Log(FAILURE, "%s - unable to write '%s'", __FUNCTION__, m_channelcachefile.c_str());
+}
+
+
+/** OPCODE's 60 - 69: XVDR network functions for timer access */
+
+int Connection::GetTimersCount()
+{
+  // the list starts with the count
+  if (m_statusinterface)
+  {
+    MsgPacket* vresp = ReadTimers();
+
+    if (vresp != NULL)
+      m_timercount = vresp->get_U32();
+
+    delete vresp;
+    return m_timercount;
+  }
+
+  MutexLock lock(&m_cmdlock);
+
+  // return caches values on connection loss
+  if(ConnectionLost())
+    return m_timercount;
+
+  MsgPacket vrp(XVDR_TIMER_GETCOUNT);
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (!vresp)
+    return m_timercount;
+
+  m_timercount = vresp->get_U32();
+
+  delete vresp;
+  return m_timercount;
+}
+
+bool Connection::GetTimerInfo(unsigned int timernumber, Timer& tag)
+{
+  MutexLock lock(&m_cmdlock);
+
+  MsgPacket vrp(XVDR_TIMER_GET);
+  vrp.put_U32(timernumber);
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (!vresp)
+  {
+    delete vresp;
+    return false;
+  }
+
+  uint32_t returnCode = vresp->get_U32();
+  if (returnCode != XVDR_RET_OK)
+  {
+    delete vresp;
+    if (returnCode == XVDR_RET_DATAUNKNOWN)
+      return false;
+    else if (returnCode == XVDR_RET_ERROR)
+      return false;
+  }
+
+  tag << vresp;
+
+  delete vresp;
+  return true;
+}
+
+MsgPacket* Connection::ReadTimers()
+{
+  // answered by the cache until the server reports a change
+  MsgPacket vrp(XVDR_TIMER_GETLIST);
+  return ReadCached(m_timercache, &vrp);
+}
+
+bool Connection::GetTimersList()
+{
+  MsgPacket* vresp = ReadTimers();
+  if (!vresp)
+  {
+    delete vresp;
+    return false;
+  }
+
+  std::deque<Timer> timers;
+  std::vector<const Timer*> tags;
+
+  uint32_t numTimers = vresp->get_U32();
+  if (numTimers > 0)
+  {
+    while (!vresp->eop())
+    {
+      timers.push_back(Timer());
+      timers.back() << vresp;
+      tags.push_back(&timers.back());
+    }
+  }
+  delete vresp;
+
+  m_client->TransferTimerEntries(tags);
+  return true;
+}
+
+bool Connection::AddTimer(const Timer& timer)
+{
+  MutexLock lock(&m_cmdlock);
+
+  MsgPacket vrp(XVDR_TIMER_ADD);
+  vrp << timer;
+
+  MsgPacket* vresp = ReadResult(&vrp);
+
+  // read the timers again even if the notification is late
+  m_timercache->Invalidate();
+
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return false;
+  }
+  uint32_t returnCode = vresp->get_U32();
+  delete vresp;
+
+  return (returnCode == XVDR_RET_OK);
+}
+
+int Connection::DeleteTimer(uint32_t timerindex, bool force)
+{
+  MutexLock lock(&m_cmdlock);
+
+  MsgPacket vrp(XVDR_TIMER_DELETE);
+  vrp.put_U32(timerindex);
+  vrp.put_U32(force);
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  m_timercache->Invalidate();
+
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return false;
+  }
+
+  uint32_t returnCode = vresp->get_U32();
+  delete vresp;
+
+  return returnCode;
+}
+
+bool Connection::UpdateTimer(const Timer& timer)
+{
+  MutexLock lock(&m_cmdlock);
+
+  MsgPacket vrp(XVDR_TIMER_UPDATE);
+  vrp << timer;
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  m_timercache->Invalidate();
+
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return false;
+  }
+
+  uint32_t returnCode = vresp->get_U32();
+  delete vresp;
+
+  return (returnCode == XVDR_RET_OK);
+}
+
+int Connection::GetRecordingsCount()
+{
+  // the index is kept up to date by the status messages
+  if (m_statusinterface && m_recindex->Valid())
+    return m_recindex->Count();
+
+  MutexLock lock(&m_cmdlock);
+
+  if(ConnectionLost())
+    return 0;
+
+  MsgPacket vrp(XVDR_RECORDINGS_GETCOUNT);
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (!vresp)
+    return -1;
+
+  uint32_t count = vresp->get_U32();
+
+  delete vresp;
+  return count;
+}
+
+bool Connection::GetRecordingsList()
+{
+  // without status messages we won't hear about changes
+  if (!ConnectionLost() && (!m_statusinterface || !m_recindex->Valid()))
+  {
+    if (RefreshRecordingIndex() < 0)
+      return false;
+  }
+
+  m_recindex->Transfer(m_client);
+  return true;
+}
+
+bool Connection::SetRecordingIndex(const std::string& filename)
+{
+  m_recindexfile = filename;
+
+  if (filename.empty() || !m_recindex->Load(filename))
+    return false;
+
+  m_client->Log(DEBUG, "%s - %i recordings loaded from '%s'", __FUNCTION__, m_recindex->Count(), filename.c_str());
+
+  // verify the stored list in the background
+  ScheduleTasks(TASK_RECORDINGS);
+  return true;
+}
+
+int Connection::RefreshRecordingIndex()
+{
+  MsgPacket vrp(XVDR_RECORDINGS_GETLIST);
+  RecordingDecoder decoder(m_recindex);
+
+  if (!ReadStream(&vrp, decoder))
+  {
+    m_client->Log(FAILURE, "%s - unable to get recordings list", __FUNCTION__);
+    return -1;
+  }
+
+  std::vector<std::string> changed;
+  int changes = m_recindex->Update(decoder.entries, &changed);
+
+  // cut marks of changed recordings must be fetched again
+  {
+    MutexLock lock(&m_recedllock);
+
+    for (std::vector<std::string>::iterator i = changed.begin(); i != changed.end(); i++)
+      m_recedls.erase(*i);
+  }
+
+  ScheduleTasks(TASK_POSITIONS | TASK_EDLS);
+
+  if (changes > 0)
+  {
+    m_client->Log(DEBUG, "%s - %i changes in %i recordings", __FUNCTION__, changes, m_recindex->Count());
+
+    if (!m_recindexfile.empty() && !m_recindex->Save(m_recindexfile))
+      m_client->Log(FAILURE, "%s - unable to write '%s'", __FUNCTION__, m_recindexfile.c_str());
+  }
+
+  return changes;
+}
+
+bool Connection::RenameRecording(const std::string& recid, const std::string& newname)
+{
+  MutexLock lock(&m_cmdlock);
+  m_client->Log(DEBUG, "%s - uid: %s", __FUNCTION__, recid.c_str());
+
+  MsgPacket vrp(XVDR_RECORDINGS_RENAME);
+  vrp.put_String(recid.c_str());
+  vrp.put_String(newname.c_str());
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return false;
+  }
+
+  uint32_t returnCode = vresp->get_U32();
+  delete vresp;
+
+  return (returnCode == XVDR_RET_OK);
+}
+
+int Connection::DeleteRecording(const std::string& recid)
+{
+  MutexLock lock(&m_cmdlock);
+
+  MsgPacket vrp(XVDR_RECORDINGS_DELETE);
+  vrp.put_String(recid.c_str());
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return false;
+  }
+
+  uint32_t returnCode = vresp->get_U32();
+  delete vresp;
+
+  return returnCode;
+}
+
+bool Connection::OnResponsePacket(MsgPacket* pkt)
+{
+  return false;
+}
+
+void Connection::Action()
+{
+  MsgPacket* vresp;
+
+  while (Running())
+  {
+    // try to reconnect
+    if(ConnectionLost() && !TryReconnect())
+    {
+      CondWait::SleepMs(500);
+      continue;
+   }
+
+    // read message
+    vresp = Session::ReadMessage();
+
+    // there wasn't any response
+    if (vresp == NULL)
+      continue;
+
+    // CHANNEL_REQUEST_RESPONSE
 
     if (vresp->getType() == XVDR_CHANNEL_REQUEST_RESPONSE)
     {
-      MutexLock lock(&m_mutex);
-      SMessages::iterator it = m_queue.find(vresp->getUID());
-      if (it != m_queue.end())
-      {
-        it->second.pkt = vresp;
-        it->second.event->Signal();
-        vresp = NULL;
-      }
+      MutexLock lock(&m_mutex);
+      SMessages::iterator it = m_queue.find(vresp->getUID());
+      if (it != m_queue.end())
+      {
+        it->second.pkt = vresp;
+        it->second.event->Signal();
+      }
+      // nobody waits for this response (cancelled request)
+      else
+      {
+        delete vresp;
+      }
+    }
+
+    // CHANNEL_STATUS
+
+    else if (vresp->getType() == XVDR_CHANNEL_STATUS)
+    {
+      if (vresp->getMsgID() == XVDR_STATUS_MESSAGE)
+      {
+        uint32_t type = vresp->get_U32();
+        const char* msgstr = vresp->get_String();
+
+        if (type == 2)
+          m_client->Notification(FAILURE, msgstr);
+        if (type == 1)
+          m_client->Notification(WARNING, msgstr);
+        else
+          m_client->Notification(INFO, msgstr);
+
+      }
+      else if (vresp->getMsgID() == XVDR_STATUS_RECORDING)
+      {
+                           vresp->get_U32(); // device currently unused
+        uint32_t on      = vresp->get_U32();
+        const char* str1 = vresp->get_String();
+        const char* str2 = vresp->get_String();
+
+        {
+          MutexLock lock(&m_mutex);
+
+          if (on)
+            m_activerecordings.insert(str1);
+          else
+            m_activerecordings.erase(str1);
+
+          // the open recording is finished, a last check at the end is enough
+          if (!on && str1 == m_recname)
+            m_recgrowing = false;
+        }
+
+        m_client->Recording(str1, str2, on);
+
+        // the timer is recording now (or not anymore)
+        m_timercache->Invalidate();
+        ScheduleUpdate(TASK_TIMERS);
+      }
+      else if (vresp->getMsgID() == XVDR_STATUS_TIMERCHANGE)
+      {
+        m_client->Log(DEBUG, "Server requested timer update");
+        m_timercache->Invalidate();
+        ScheduleUpdate(TASK_TIMERS);
+      }
+      else if (vresp->getMsgID() == XVDR_STATUS_CHANNELCHANGE)
+      {
+        m_client->Log(DEBUG, "Server requested channel update");
+        ScheduleUpdate(TASK_CHANNELS);
+      }
+      else if (vresp->getMsgID() == XVDR_STATUS_RECORDINGSCHANGE)
+      {
+        m_client->Log(DEBUG, "Server requested recordings update");
+
+        // resume points may have been changed by someone else,
+        // only the ones still to be written are known for sure
+        {
+          MutexLock lock(&m_recstatelock);
+          m_recpositions = m_recdirtypositions;
+        }
+
+        ScheduleUpdate(TASK_RECORDINGS);
+      }
+      else if (vresp->getMsgID() == XVDR_STATUS_CHANNELSCAN)
+      {
+        ChannelScannerStatus status;
+        status << vresp;
+        m_client->OnChannelScannerStatus(status);
+      }
+    }
+
+    // OTHER CHANNELID
+
+    else if (!OnResponsePacket(vresp))
+    {
+      delete vresp;
+    }
+  }
+}
+
+int Connection::GetChannelGroupCount(bool automatic)
+{
+  // the groups differ between both modes
+  m_channelcache->SetContext("groups", automatic ? "automatic" : "manual");
+
+  if (automatic != m_groupsautomatic)
+  {
+    m_groupsautomatic = automatic;
+    m_groupscounted = false;
+  }
+
+  MsgPacket vrp(XVDR_CHANNELGROUP_GETCOUNT);
+  vrp.put_U32(automatic);
+
+  bool cached = false;
+  MsgPacket* vresp = ReadCached(m_channelcache, &vrp, &cached);
+
+  if (!cached && vresp != NULL)
+    m_groupscounted = true;
+
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return 0;
+  }
+
+  uint32_t count = vresp->get_U32();
+
+  delete vresp;
+  return count;
+}
+
+bool Connection::GetChannelGroupList(bool bRadio)
+{
+  MsgPacket vrp(XVDR_CHANNELGROUP_LIST);
+  vrp.put_U8(bRadio);
+
+  MsgPacket* vresp = ReadChannelGroups(&vrp);
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return false;
+  }
+
+  while (!vresp->eop())
+  {
+    ChannelGroup group(vresp);
+    m_client->TransferChannelGroup(group);
+  }
+
+  delete vresp;
+  return true;
+}
+
+bool Connection::GetChannelGroupMembers(const std::string& groupname, bool radio)
+{
+  MsgPacket vrp(XVDR_CHANNELGROUP_MEMBERS);
+  vrp.put_String(groupname.c_str());
+  vrp.put_U8(radio);
+
+  MsgPacket* vresp = ReadChannelGroups(&vrp);
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return false;
+  }
+
+  while (!vresp->eop())
+  {
+    ChannelGroupMember member(vresp);
+    member.Name = groupname;
+    m_client->TransferChannelGroupMember(member);
+  }
+
+  delete vresp;
+  return true;
+}
+
+bool Connection::OpenRecording(const std::string& recid)
+{
+  MutexLock lock(&m_cmdlock);
+
+  MsgPacket vrp(XVDR_RECSTREAM_OPEN);
+  vrp.put_String(recid.c_str());
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (!vresp)
+    return false;
+
+  uint32_t returnCode = vresp->get_U32();
+  if (returnCode == XVDR_RET_OK)
+  {
+    m_recframes                     = vresp->get_U32();
+    m_currentPlayingRecordBytes     = vresp->get_U64();
+    m_currentPlayingRecordPosition  = 0;
+    m_recid = recid;
+
+    CancelRecordingPrefetch();
+    m_reccache->Clear();
+    m_recnextpos = 0;
+    m_recsequential = 0;
+    m_recupdate.Set(RECORDING_PROBE);
+    m_recprobe = true;
+    m_rechits = 0;
+    m_recmisses = 0;
+
+    m_reciframes.clear();
+    m_recframepositions.clear();
+
+    CancelTrickPlay();
+    m_recspeed = 0;
+
+    OpenRecordingStripes();
+
+    std::string name = m_recindex->GetName(recid);
+
+    MutexLock lock(&m_mutex);
+    m_recgrowing = false;
+    m_recname = name;
+  }
+  else {
+    m_client->Log(FAILURE, "%s - Can't open recording", __FUNCTION__);
+    m_recid.clear();
+
+  }
+  delete vresp;
+  return (returnCode == XVDR_RET_OK);
+}
+
+bool Connection::CloseRecording()
+{
+  MutexLock lock(&m_cmdlock);
+
+  if(m_recid.empty())
+    return false;
+
+  m_recid.clear();
+
+  CancelTrickPlay();
+  m_recspeed = 0;
+
+  CancelRecordingPrefetch();
+  CloseRecordingStripes();
+  m_reccache->Clear();
+
+  m_client->Log(DEBUG, "recording cache: %llu hits, %llu misses", (unsigned long long)m_rechits, (unsigned long long)m_recmisses);
+
+  MsgPacket vrp(XVDR_RECSTREAM_CLOSE);
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (!vresp)
+    return false;
+
+  uint32_t returnCode = vresp->get_U32();
+  return (returnCode == XVDR_RET_OK);
+}
+
+int Connection::ReadRecording(unsigned char* buf, uint32_t buf_size)
+{
+  MutexLock lock(&m_cmdlock);
+
+  if (ConnectionLost())
+    return 0;
+
+  if (RecordingLengthExpired())
+    UpdateRecordingLength();
+
+  if (m_recspeed != 0)
+    return ReadTrickPlay(buf, buf_size);
+
+  if (m_currentPlayingRecordPosition >= m_currentPlayingRecordBytes)
+    return 0;
+
+  // sequential reads switch on the read-ahead
+  if (m_currentPlayingRecordPosition == m_recnextpos)
+    m_recsequential++;
+  else
+    m_recsequential = 0;
+
+  uint32_t length = m_reccache->Read(m_currentPlayingRecordPosition, buf, buf_size);
+
+  if (length > 0)
+    m_rechits++;
+  else
+  {
+    m_recmisses++;
+
+    if (!FetchRecordingBlock(m_reccache->BlockStart(m_currentPlayingRecordPosition)))
+      return -1;
+
+    length = m_reccache->Read(m_currentPlayingRecordPosition, buf, buf_size);
+
+    if (length == 0)
+      return -1;
+  }
+
+  m_currentPlayingRecordPosition += length;
+  m_recnextpos = m_currentPlayingRecordPosition;
+
+  if (m_recsequential >= 2)
+    PrefetchRecording();
+
+  return length;
+}
+
+void Connection::SetRecordingPrefetch(int blocks)
+{
+  MutexLock lock(&m_cmdlock);
+  m_recprefetch = (blocks < 0) ? 0 : blocks;
+}
+
+bool Connection::SetRecordingCache(size_t size, const std::string& spillfile, size_t spillsize)
+{
+  MutexLock lock(&m_cmdlock);
+
+  m_reccache->SetMaxSize(size);
+  return m_reccache->SetSpillFile(spillfile, spillsize);
+}
+
+void Connection::GetRecordingCacheStats(uint64_t* hits, uint64_t* misses)
+{
+  MutexLock lock(&m_cmdlock);
+
+  *hits = m_rechits;
+  *misses = m_recmisses;
+}
+
+bool Connection::RecordingLengthExpired()
+{
+  if (!m_recupdate.TimedOut())
+    return false;
+
+  bool growing = false;
+
+  {
+    MutexLock lock(&m_mutex);
+
+    // without status messages we can't tell if the recording is still running
+    growing = m_recgrowing || !m_statusinterface || (!m_recname.empty() && m_activerecordings.count(m_recname) > 0);
+  }
+
+  uint64_t lookahead = (uint64_t)(m_recprefetch + 1) * m_reccache->BlockSize();
+  bool nearend = (m_currentPlayingRecordPosition + lookahead >= m_currentPlayingRecordBytes);
+
+  // recordings started before we connected only show up by growing
+  bool probe = m_recprobe;
+  m_recprobe = false;
+
+  // finished recordings only need a last check at the end
+  if (!growing && !nearend && !probe)
+    return false;
+
+  m_recupdate.Set(nearend ? 1000 : 10000);
+  return true;
+}
+
+bool Connection::UpdateRecordingLength()
+{
+  MsgPacket vrp(XVDR_RECSTREAM_UPDATE);
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (vresp == NULL)
+    return false;
+
+  m_recframes    = vresp->get_U32();
+  uint64_t bytes  = vresp->get_U64();
+
+  if(bytes != m_currentPlayingRecordBytes) {
+    m_currentPlayingRecordBytes  = bytes;
+    m_client->Log(DEBUG, "Size of recording changed: %lu bytes", bytes);
+
+    // the stripe sessions need to know about the new length too
+    for (std::vector<RecordingStripe*>::iterator i = m_recsessions.begin(); i != m_recsessions.end(); i++)
+      (*i)->Update();
+
+    MutexLock lock(&m_mutex);
+    m_recgrowing = true;
+  }
+
+  delete vresp;
+  return true;
+}
+
+bool Connection::RequestRecordingBlock(uint64_t position, RecordingRequest& r)
+{
+  // blocks are striped across the sessions
+  size_t stripe = (size_t)((position / m_reccache->BlockSize()) % (m_recsessions.size() + 1));
+
+  r.position = position;
+  r.stripe = (stripe == 0) ? NULL : m_recsessions[stripe - 1];
+  r.request = new MsgPacket(XVDR_RECSTREAM_GETBLOCK);
+  r.request->put_U64(position);
+  r.request->put_U32(m_reccache->BlockSize());
+
+  // the blocks of a lost session go to the main one
+  if (r.stripe != NULL && r.stripe->ConnectionLost())
+    r.stripe = NULL;
+
+  // receive into the memory of a dropped cache block
+  MsgPacket* buffer = m_reccache->Recycle();
+
+  if (r.stripe != NULL ? !r.stripe->Send(r.request, buffer) : !SendRequest(r.request, buffer))
+  {
+    delete r.request;
+    return false;
+  }
+
+  return true;
+}
+
+bool Connection::FetchRecordingBlock(uint64_t position)
+{
+  bool pending = false;
+
+  for (std::deque<RecordingRequest>::iterator i = m_recrequests.begin(); i != m_recrequests.end(); i++)
+  {
+    if (i->position == position)
+    {
+      pending = true;
+      break;
+    }
+  }
+
+  // not on its way, request it now
+  if (!pending)
+  {
+    RecordingRequest r;
+
+    if (!RequestRecordingBlock(position, r))
+      return false;
+
+    m_recrequests.push_front(r);
+  }
+
+  // collect the responses up to the requested block
+  while (!m_recrequests.empty())
+  {
+    RecordingRequest r = m_recrequests.front();
+    m_recrequests.pop_front();
+
+    MsgPacket* vresp = (r.stripe != NULL) ? r.stripe->Receive(r.request) : ReceiveResult(r.request);
+    delete r.request;
+
+    if (vresp == NULL || vresp->getPayloadLength() == 0)
+    {
+      delete vresp;
+      CancelRecordingPrefetch();
+      return false;
+    }
+
+    if (vresp->getPayloadLength() > m_reccache->BlockSize())
+    {
+      m_client->Log(FAILURE, "%s: PANIC - Received more bytes as requested", __FUNCTION__);
+      delete vresp;
+      CancelRecordingPrefetch();
+      return false;
+    }
+
+    m_reccache->Put(r.position, vresp);
+
+    if (r.position == position)
+      return true;
+  }
+
+  return false;
+}
+
+void Connection::PrefetchRecording()
+{
+  uint32_t blocksize = m_reccache->BlockSize();
+  uint64_t next = m_reccache->BlockStart(m_currentPlayingRecordPosition) + blocksize;
+  uint64_t end = next + (uint64_t)m_recprefetch * blocksize;
+
+  if (m_recprefetchpos < next)
+    m_recprefetchpos = next;
+
+  // keep the window ahead of the reader in flight
+  while (m_recprefetchpos < end && m_recprefetchpos < m_currentPlayingRecordBytes)
+  {
+    if (!m_reccache->Contains(m_recprefetchpos))
+    {
+      RecordingRequest r;
+
+      if (!RequestRecordingBlock(m_recprefetchpos, r))
+        return;
+
+      m_recrequests.push_back(r);
+    }
+
+    m_recprefetchpos += blocksize;
+  }
+}
+
+void Connection::CancelRecordingPrefetch()
+{
+  while (!m_recrequests.empty())
+  {
+    RecordingRequest& r = m_recrequests.front();
+
+    if (r.stripe != NULL)
+      r.stripe->Cancel(r.request);
+    else
+      CancelRequest(r.request);
+
+    delete r.request;
+    m_recrequests.pop_front();
+  }
+
+  m_recprefetchpos = 0;
+}
+
+void Connection::SetRecordingStripes(int sessions)
+{
+  MutexLock lock(&m_cmdlock);
+  m_recstripes = (sessions < 1) ? 1 : sessions;
+}
+
+void Connection::OpenRecordingStripes()
+{
+  CloseRecordingStripes();
+
+  for (int i = 1; i < m_recstripes; i++)
+  {
+    RecordingStripe* session = new RecordingStripe(m_timeout);
+
+    // go on with the sessions we got
+    if (!session->OpenRecording(m_hostname, m_name + " (stripe)", m_recid))
+    {
+      m_client->Log(FAILURE, "%s - unable to open stripe session %i", __FUNCTION__, i);
+      delete session;
+      break;
+    }
+
+    m_recsessions.push_back(session);
+  }
+}
+
+void Connection::CloseRecordingStripes()
+{
+  for (std::vector<RecordingStripe*>::iterator i = m_recsessions.begin(); i != m_recsessions.end(); i++)
+    delete *i;
+
+  m_recsessions.clear();
+}
+
+bool Connection::DownloadRecording(const std::string& recid, const std::string& filename, int sessions)
+{
+  std::vector<RecordingStripe*> stripes;
+  bool rc = true;
+
+  // plain sessions without reader thread, status messages or caches
+  for (int i = 0; i < std::max(sessions, 1); i++)
+  {
+    RecordingStripe* session = new RecordingStripe(m_timeout);
+
+    if (!session->OpenRecording(m_hostname, "recording download", recid))
+    {
+      m_client->Log(FAILURE, "%s - unable to open download session %i", __FUNCTION__, i);
+      delete session;
+      rc = false;
+      break;
+    }
+
+    stripes.push_back(session);
+  }
+
+  FILE* file = NULL;
+
+  if (rc && (file = fopen(filename.c_str(), "wb")) == NULL)
+  {
+    m_client->Log(FAILURE, "%s - unable to create '%s'", __FUNCTION__, filename.c_str());
+    rc = false;
+  }
+
+  uint32_t blocksize = m_reccache->BlockSize();
+  uint64_t length = rc ? stripes[0]->RecordingLength() : 0;
+  uint64_t next = 0;
+  std::deque<RecordingRequest> requests;
+
+  // blocks are striped across the sessions and written in order
+  while (rc && (next < length || !requests.empty()))
+  {
+    while (next < length && requests.size() < DOWNLOAD_PREFETCH * stripes.size())
+    {
+      RecordingRequest r;
+      r.position = next;
+      r.stripe = stripes[(size_t)((next / blocksize) % stripes.size())];
+      r.request = new MsgPacket(XVDR_RECSTREAM_GETBLOCK);
+      r.request->put_U64(next);
+      r.request->put_U32(blocksize);
+
+      requests.push_back(r);
+      next += blocksize;
+
+      if (!r.stripe->Send(r.request))
+      {
+        rc = false;
+        break;
+      }
+    }
+
+    if (!rc)
+      break;
+
+    RecordingRequest r = requests.front();
+    requests.pop_front();
+
+    MsgPacket* vresp = r.stripe->Receive(r.request);
+    delete r.request;
+
+    uint32_t size = (vresp != NULL) ? vresp->getPayloadLength() : 0;
+
+    if (size == 0 || size > blocksize || fwrite(vresp->getPayload(), 1, size, file) != size)
+      rc = false;
+
+    delete vresp;
+  }
+
+  for (std::deque<RecordingRequest>::iterator i = requests.begin(); i != requests.end(); i++)
+    delete i->request;
+
+  for (std::vector<RecordingStripe*>::iterator i = stripes.begin(); i != stripes.end(); i++)
+    delete *i;
+
+  if (file != NULL)
+    fclose(file);
+
+  return rc;
+}
+
+long long Connection::SeekRecording(long long pos, uint32_t whence)
+{
+  MutexLock lock(&m_cmdlock);
+  uint64_t nextPos = m_currentPlayingRecordPosition;
+
+  switch (whence)
+  {
+    case SEEK_SET:
+      nextPos = pos;
+      break;
+
+    case SEEK_CUR:
+      nextPos += pos;
+      break;
+
+    case SEEK_END:
+      nextPos = m_currentPlayingRecordBytes + pos;
+      break;
+
+    case SEEK_POSSIBLE:
+      return 1;
+
+    default:
+      return -1;
+  }
+
+  return SetRecordingPosition(nextPos);
+}
+
+long long Connection::SetRecordingPosition(uint64_t position)
+{
+  if (position > m_currentPlayingRecordBytes)
+    return -1;
+
+  // the read-ahead is useless after a jump, cached blocks stay valid
+  if (position != m_currentPlayingRecordPosition)
+    CancelRecordingPrefetch();
+
+  m_currentPlayingRecordPosition = position;
+
+  // trick-play goes on from the new position
+  if (m_recspeed != 0 && !StartTrickPlay())
+    return -1;
+
+  return m_currentPlayingRecordPosition;
+}
+
+uint32_t Connection::RecordingFrames(void)
+{
+  MutexLock lock(&m_cmdlock);
+  return m_recframes;
+}
+
+int Connection::RecordingFrame(void)
+{
+  MutexLock lock(&m_cmdlock);
+
+  if (m_recid.empty())
+    return -1;
+
+  return FrameAtPosition(m_currentPlayingRecordPosition);
+}
+
+int Connection::FrameAtPosition(uint64_t position)
+{
+  std::map<uint64_t, uint32_t>::iterator i = m_recframepositions.find(position);
+
+  if (i != m_recframepositions.end())
+    return i->second;
+
+  MsgPacket vrp(XVDR_RECSTREAM_POSTOFRAME);
+  vrp.put_U64(position);
+
+  MsgPacket* vresp = ReadResult(&vrp);
+  if (vresp == NULL || vresp->eop())
+  {
+    delete vresp;
+    return -1;
+  }
+
+  uint32_t frame = vresp->get_U32();
+  delete vresp;
+
+  m_recframepositions[position] = frame;
+  return frame;
+}
+
+long long Connection::SeekRecordingFrame(uint32_t frame)
+{
+  MutexLock lock(&m_cmdlock);
+
+  if (m_recid.empty())
+    return -1;
+
+  if (m_recframes > 0 && frame >= m_recframes)
+    frame = m_recframes - 1;
+
+  // start with the I-frame in front of the requested frame
+  uint32_t number = 0;
+  uint64_t position = 0;
+  uint32_t length = 0;
+
+  if (!GetRecordingIFrame(frame, false, number, position, length))
+    return -1;
+
+  m_recframepositions[position] = number;
+
+  return SetRecordingPosition(position);
+}
+
+long long Connection::SeekRecordingTime(int ms, double fps)
+{
+  if (ms < 0 || fps <= 0)
+    return -1;
+
+  return SeekRecordingFrame((uint32_t)((double)ms * fps / 1000.0));
+}
+
+bool Connection::GetRecordingIFrame(uint32_t frame, bool forward, uint32_t& number, uint64_t& position, uint32_t& length)
+{
+  if (LookupRecordingIFrame(frame, forward, number, position, length))
+    return true;
+
+  MsgPacket vrp(XVDR_RECSTREAM_GETIFRAME);
+  vrp.put_U32(frame);
+  vrp.put_U32(forward);
+
+  return StoreRecordingIFrame(frame, forward, ReadResult(&vrp), number, position, length);
+}
+
+bool Connection::LookupRecordingIFrame(uint32_t frame, bool forward, uint32_t& number, uint64_t& position, uint32_t& length)
+{
+  std::map<uint32_t, RecordingIFrame>::iterator i;
+
+  // resolve locally if an earlier lookup covered this frame
+  if (forward)
+  {
+    i = m_reciframes.lower_bound(frame);
+
+    if (i != m_reciframes.end() && i->second.first > frame)
+      i = m_reciframes.end();
+  }
+  else
+  {
+    i = m_reciframes.upper_bound(frame);
+
+    if (i == m_reciframes.begin() || (--i)->second.last < frame)
+      i = m_reciframes.end();
+  }
+
+  if (i == m_reciframes.end())
+    return false;
+
+  number = i->first;
+  position = i->second.position;
+  length = i->second.length;
+  return true;
+}
+
+bool Connection::StoreRecordingIFrame(uint32_t frame, bool forward, MsgPacket* vresp, uint32_t& number, uint64_t& position, uint32_t& length)
+{
+  if (vresp == NULL || vresp->getPayloadLength() < 16)
+  {
+    delete vresp;
+    return false;
+  }
+
+  position = vresp->get_U64();
+  number   = vresp->get_U32();
+  length   = vresp->get_U32();
+  delete vresp;
+
+  // remember which frames lead to this I-frame
+  std::pair<std::map<uint32_t, RecordingIFrame>::iterator, bool> r = m_reciframes.insert(std::make_pair(number, RecordingIFrame()));
+  RecordingIFrame& iframe = r.first->second;
+
+  if (r.second)
+  {
+    iframe.first = number;
+    iframe.last = number;
+  }
+
+  iframe.position = position;
+  iframe.length = length;
+
+  if (forward)
+    iframe.first = std::min(iframe.first, frame);
+  else
+    iframe.last = std::max(iframe.last, frame);
+
+  return true;
+}
+
+bool Connection::SetRecordingSpeed(int speed)
+{
+  MutexLock lock(&m_cmdlock);
+
+  if (m_recid.empty())
+    return false;
+
+  // normal playback for 0 and 1
+  if (speed == 1)
+    speed = 0;
+
+  if (speed == m_recspeed)
+    return true;
+
+  CancelTrickPlay();
+  CancelRecordingPrefetch();
+
+  m_recspeed = speed;
+
+  if (m_recspeed == 0)
+    return true;
+
+  if (!StartTrickPlay())
+  {
+    m_recspeed = 0;
+    return false;
+  }
+
+  return true;
+}
+
+bool Connection::StartTrickPlay()
+{
+  CancelTrickPlay();
+
+  int frame = FrameAtPosition(m_currentPlayingRecordPosition);
+
+  if (frame < 0)
+    return false;
+
+  m_rectricktarget = frame + m_recspeed * TRICKPLAY_GOP;
+  m_rectricklast = -1;
+
+  return true;
+}
+
+bool Connection::RequestTrickPlayFrame(TrickPlayFrame& f)
+{
+  f.lookup = NULL;
+  f.request = NULL;
+
+  // ask for the I-frame position first unless we know it already
+  if (!LookupRecordingIFrame(f.target, false, f.number, f.position, f.length))
+  {
+    f.lookup = new MsgPacket(XVDR_RECSTREAM_GETIFRAME);
+    f.lookup->put_U32(f.target);
+    f.lookup->put_U32(0);
+
+    if (!SendRequest(f.lookup))
+    {
+      delete f.lookup;
+      return false;
     }
 
-    // CHANNEL_STATUS
+    return true;
+  }
 
-    else if (vresp->getType() == XVDR_CHANNEL_STATUS)
+  ResolveTrickPlayFrame(f, NULL);
+  return true;
+}
+
+void Connection::ResolveTrickPlayFrame(TrickPlayFrame& f, MsgPacket* vresp)
+{
+  if (f.lookup != NULL)
+  {
+    delete f.lookup;
+    f.lookup = NULL;
+
+    if (!StoreRecordingIFrame(f.target, false, vresp, f.number, f.position, f.length))
+      return;
+  }
+
+  // fetch the I-frame, nothing more
+  f.request = new MsgPacket(XVDR_RECSTREAM_GETBLOCK);
+  f.request->put_U64(f.position);
+  f.request->put_U32(f.length);
+
+  if (!SendRequest(f.request))
+  {
+    delete f.request;
+    f.request = NULL;
+  }
+}
+
+void Connection::PrefetchTrickPlay()
+{
+  while (m_rectrick.size() < TRICKPLAY_PREFETCH)
+  {
+    if (m_rectricktarget < 0 || (m_recframes > 0 && m_rectricktarget >= m_recframes))
+      break;
+
+    TrickPlayFrame f;
+    f.target = (uint32_t)m_rectricktarget;
+
+    if (!RequestTrickPlayFrame(f))
+      break;
+
+    m_rectrick.push_back(f);
+    m_rectricktarget += m_recspeed * TRICKPLAY_GOP;
+  }
+
+  // fetch the I-frames of the lookups answered meanwhile
+  for (std::deque<TrickPlayFrame>::iterator i = m_rectrick.begin(); i != m_rectrick.end(); i++)
+  {
+    if (i->lookup == NULL)
+      continue;
+
+    MsgPacket* vresp = ReceiveResult(i->lookup, false);
+
+    if (vresp != NULL)
+      ResolveTrickPlayFrame(*i, vresp);
+  }
+}
+
+void Connection::CancelTrickPlay()
+{
+  while (!m_rectrick.empty())
+  {
+    TrickPlayFrame& f = m_rectrick.front();
+
+    if (f.lookup != NULL)
     {
-      if (vresp->getMsgID() == XVDR_STATUS_MESSAGE)
-      {
-        uint32_t type = vresp->get_U32();
-        const char* msgstr = vresp->get_String();
+      CancelRequest(f.lookup);
+      delete f.lookup;
+    }
 
-        if (type == 2)
-          m_client->Notification(FAILURE, msgstr);
-        if (type == 1)
-          m_client->Notification(WARNING, msgstr);
-        else
-          m_client->Notification(INFO, msgstr);
+    if (f.request != NULL)
+    {
+      CancelRequest(f.request);
+      delete f.request;
+    }
 
-      }
-      else if (vresp->getMsgID() == XVDR_STATUS_RECORDING)
-      {
-                           vresp->get_U32(); // device currently unused
-        uint32_t on      = vresp->get_U32();
-        const char* str1 = vresp->get_String();
-        const char* str2 = vresp->get_String();
+    m_rectrick.pop_front();
+  }
 
-        m_client->Recording(str1, str2, on);
-        m_client->TriggerTimerUpdate();
-      }
-      else if (vresp->getMsgID() == XVDR_STATUS_TIMERCHANGE)
-      {
-        m_client->Log(DEBUG, "Server requested timer update");
-        m_client->TriggerTimerUpdate();
-      }
-      else if (vresp->getMsgID() == XVDR_STATUS_CHANNELCHANGE)
-      {
-        m_client->Log(DEBUG, "Server requested channel update");
-        m_client->TriggerChannelUpdate();
-      }
-      else if (vresp->getMsgID() == XVDR_STATUS_RECORDINGSCHANGE)
-      {
-        m_client->Log(DEBUG, "Server requested recordings update");
-        m_client->TriggerRecordingUpdate();
-      }
-      else if (vresp->getMsgID() == XVDR_STATUS_CHANNELSCAN)
+  delete m_rectrickframe;
+  m_rectrickframe = NULL;
+  m_rectrickoffset = 0;
+}
+
+int Connection::ReadTrickPlay(unsigned char* buf, uint32_t buf_size)
+{
+  // hand out the rest of the current I-frame first
+  if (m_rectrickframe != NULL && m_rectrickoffset >= m_rectrickframe->getPayloadLength())
+  {
+    delete m_rectrickframe;
+    m_rectrickframe = NULL;
+  }
+
+  while (m_rectrickframe == NULL)
+  {
+    PrefetchTrickPlay();
+
+    // beginning or end of the recording reached (or the requests failed)
+    if (m_rectrick.empty())
+      return ConnectionLost() ? -1 : 0;
+
+    TrickPlayFrame f = m_rectrick.front();
+    m_rectrick.pop_front();
+
+    if (f.lookup != NULL)
+    {
+      MsgPacket* vresp = ReceiveResult(f.lookup);
+
+      // no answer is an error, an empty one means there is no I-frame
+      if (vresp == NULL)
       {
-        ChannelScannerStatus status;
-        status << vresp;
-        m_client->OnChannelScannerStatus(status);
+        CancelRequest(f.lookup);
+        delete f.lookup;
+        CancelTrickPlay();
+        return -1;
       }
+
+      ResolveTrickPlayFrame(f, vresp);
+    }
+
+    // no I-frame at the target: beginning or end of the recording
+    if (f.request == NULL)
+    {
+      CancelTrickPlay();
+      return ConnectionLost() ? -1 : 0;
+    }
+
+    MsgPacket* vresp = ReceiveResult(f.request);
+    delete f.request;
+
+    if (vresp == NULL || vresp->getPayloadLength() == 0)
+    {
+      delete vresp;
+      CancelTrickPlay();
+      return -1;
     }
 
-    // OTHER CHANNELID
-
-    else if (!OnResponsePacket(vresp))
+    // neighbouring targets may end up on the same I-frame
+    if ((int64_t)f.number == m_rectricklast)
     {
       delete vresp;
+      continue;
     }
-  }
-}
-
-int Connection::GetChannelGroupCount(bool automatic)
-{
-  MutexLock lock(&m_cmdlock);
 
-  MsgPacket vrp(XVDR_CHANNELGROUP_GETCOUNT);
-  vrp.put_U32(automatic);
+    m_rectricklast = f.number;
+    m_rectrickframe = vresp;
+    m_rectrickoffset = 0;
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL || vresp->eop())
-  {
-    delete vresp;
-    return 0;
+    // normal playback resumes from the last I-frame shown
+    m_currentPlayingRecordPosition = f.position;
   }
 
-  uint32_t count = vresp->get_U32();
+  uint32_t length = std::min(buf_size, m_rectrickframe->getPayloadLength() - m_rectrickoffset);
+  memcpy(buf, m_rectrickframe->getPayload() + m_rectrickoffset, length);
+  m_rectrickoffset += length;
 
-  delete vresp;
-  return count;
+  return length;
 }
 
-bool Connection::GetChannelGroupList(bool bRadio)
+long long Connection::RecordingPosition(void)
 {
   MutexLock lock(&m_cmdlock);
+  return m_currentPlayingRecordPosition;
+}
 
-  MsgPacket vrp(XVDR_CHANNELGROUP_LIST);
-  vrp.put_U8(bRadio);
+long long Connection::RecordingLength(void)
+{
+  MutexLock lock(&m_cmdlock);
+  return m_currentPlayingRecordBytes;
+}
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL || vresp->eop())
+bool Connection::LoadRecordingEdl(const std::string& recid, RecordingEdl& edl)
+{
   {
-    delete vresp;
-    return false;
+    MutexLock lock(&m_recedllock);
+    std::map<std::string, RecordingEdl>::iterator i = m_recedls.find(recid);
+
+    if (i != m_recedls.end())
+    {
+      edl = i->second;
+      return true;
+    }
   }
 
-  while (!vresp->eop())
+  MsgPacket vrp(XVDR_RECORDINGS_GETMARKS);
+  vrp.put_String(recid.c_str());
+
+  MsgPacket* vresp = NULL;
+
   {
-    ChannelGroup group(vresp);
-    m_client->TransferChannelGroup(group);
+    MutexLock lock(&m_cmdlock);
+    vresp = ReadResult(&vrp);
   }
 
-  delete vresp;
+  if (!ReadRecordingEdl(vresp, edl))
+    return false;
+
+  MutexLock lock(&m_recedllock);
+  m_recedls[recid] = edl;
+
   return true;
 }
 
-bool Connection::GetChannelGroupMembers(const std::string& groupname, bool radio)
+bool Connection::ReadRecordingEdl(MsgPacket* vresp, RecordingEdl& edl)
 {
-  MutexLock lock(&m_cmdlock);
-
-  MsgPacket vrp(XVDR_CHANNELGROUP_MEMBERS);
-  vrp.put_String(groupname.c_str());
-  vrp.put_U8(radio);
+  if (vresp == NULL || vresp->eop()) {
+    delete vresp;
+    return false;
+  }
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL || vresp->eop())
-  {
+  if(vresp->get_U32() != XVDR_RET_OK) {
     delete vresp;
     return false;
   }
 
-  while (!vresp->eop())
-  {
-    ChannelGroupMember member(vresp);
-    member.Name = groupname;
-    m_client->TransferChannelGroupMember(member);
+  double fps = (double)vresp->get_U64() / 10000.0;
+
+  while(!vresp->eop()) {
+    RecordingCutMark mark(vresp);
+    mark.Fps = fps;
+    edl.push_back(mark);
   }
 
   delete vresp;
   return true;
 }
 
-bool Connection::OpenRecording(const std::string& recid)
+void Connection::TransmitPipelined(std::vector<MsgPacket*>& requests, std::vector<MsgPacket*>& responses, size_t window)
 {
-  MutexLock lock(&m_cmdlock);
+  responses.assign(requests.size(), NULL);
 
-  MsgPacket vrp(XVDR_RECSTREAM_OPEN);
-  vrp.put_String(recid.c_str());
-
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return false;
+  size_t sent = 0;
+  size_t received = 0;
 
-  uint32_t returnCode = vresp->get_U32();
-  if (returnCode == XVDR_RET_OK)
+  while (received < requests.size())
   {
-    vresp->get_U32(); // number of frames is unused
-    m_currentPlayingRecordBytes     = vresp->get_U64();
-    m_currentPlayingRecordPosition  = 0;
-    m_recid = recid;
-  }
-  else {
-    m_client->Log(FAILURE, "%s - Can't open recording", __FUNCTION__);
-    m_recid.clear();
+    // keep a window of requests in flight
+    while (sent < requests.size() && sent - received < window && !m_aborting)
+    {
+      MutexLock lock(&m_cmdlock);
 
-  }
-  delete vresp;
-  return (returnCode == XVDR_RET_OK);
-}
+      if (!SendRequest(requests[sent]))
+        break;
 
-bool Connection::CloseRecording()
-{
-  MutexLock lock(&m_cmdlock);
+      sent++;
+    }
 
-  if(m_recid.empty())
-    return false;
+    // nothing on its way, sending failed
+    if (received == sent)
+      break;
 
-  m_recid.clear();
+    responses[received] = m_aborting ? NULL : ReceiveResult(requests[received]);
 
-  MsgPacket vrp(XVDR_RECSTREAM_CLOSE);
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (!vresp)
-    return false;
+    if (responses[received] == NULL)
+      CancelRequest(requests[received]);
 
-  uint32_t returnCode = vresp->get_U32();
-  return (returnCode == XVDR_RET_OK);
+    received++;
+  }
 }
 
-int Connection::ReadRecording(unsigned char* buf, uint32_t buf_size)
+void Connection::PrefetchRecordingEdls()
 {
-  MutexLock lock(&m_cmdlock);
+  std::vector<std::string> ids;
+  m_recindex->GetIds(ids);
 
-  if (ConnectionLost())
-    return 0;
+  std::vector<std::string> missing;
+  std::vector<MsgPacket*> requests;
+  std::vector<MsgPacket*> responses;
 
-  if (m_currentPlayingRecordPosition >= m_currentPlayingRecordBytes)
-    return 0;
+  {
+    MutexLock lock(&m_recedllock);
 
-  MsgPacket* vresp = NULL;
+    for (std::vector<std::string>::iterator i = ids.begin(); i != ids.end(); i++)
+    {
+      if (m_recedls.find(*i) == m_recedls.end())
+        missing.push_back(*i);
+    }
+  }
 
-  MsgPacket vrp1(XVDR_RECSTREAM_UPDATE);
-  if ((vresp = ReadResult(&vrp1)) != NULL)
+  for (std::vector<std::string>::iterator i = missing.begin(); i != missing.end(); i++)
   {
-    vresp->get_U32(); // number of frames is unused
-    uint64_t bytes  = vresp->get_U64();
+    MsgPacket* vrp = new MsgPacket(XVDR_RECORDINGS_GETMARKS);
+    vrp->put_String(i->c_str());
+    requests.push_back(vrp);
+  }
 
-    if(bytes != m_currentPlayingRecordBytes) {
-      m_currentPlayingRecordBytes  = bytes;
-      m_client->Log(DEBUG, "Size of recording changed: %lu bytes", bytes);
-    }
-    delete vresp;
+  TransmitPipelined(requests, responses, EDL_PREFETCH);
+
+  int count = 0;
+
+  for (size_t i = 0; i < requests.size(); i++)
+  {
+    delete requests[i];
+
+    if (responses[i] == NULL)
+      continue;
+
+    RecordingEdl edl;
+
+    // recordings without marks get an empty list
+    ReadRecordingEdl(responses[i], edl);
+
+    MutexLock lock(&m_recedllock);
+    m_recedls[missing[i]] = edl;
+    count++;
   }
 
-  MsgPacket vrp2(XVDR_RECSTREAM_GETBLOCK);
-  vrp2.put_U64(m_currentPlayingRecordPosition);
-  vrp2.put_U32(buf_size);
+  if (count > 0)
+    m_client->Log(DEBUG, "%s - cut marks of %i recordings fetched", __FUNCTION__, count);
+}
 
-  vresp = ReadResult(&vrp2);
-  if (!vresp)
-    return -1;
+void Connection::PrefetchRecordingPositions()
+{
+  std::vector<std::string> ids;
+  m_recindex->GetIds(ids);
 
-  uint32_t length = vresp->getPayloadLength();
+  std::vector<std::string> missing;
+  std::vector<MsgPacket*> requests;
+  std::vector<MsgPacket*> responses;
 
-  if(length == 0) {
-    return -1;
+  {
+    MutexLock lock(&m_recstatelock);
+
+    for (std::vector<std::string>::iterator i = ids.begin(); i != ids.end(); i++)
+    {
+      if (m_recpositions.find(*i) == m_recpositions.end())
+        missing.push_back(*i);
+    }
   }
 
-  uint8_t *data = vresp->getPayload();
-  if (length > buf_size)
+  for (std::vector<std::string>::iterator i = missing.begin(); i != missing.end(); i++)
   {
-    m_client->Log(FAILURE, "%s: PANIC - Received more bytes as requested", __FUNCTION__);
-    delete vresp;
-    return 0;
+    MsgPacket* vrp = new MsgPacket(XVDR_RECORDINGS_GETPOSITION);
+    vrp->put_String(i->c_str());
+    requests.push_back(vrp);
   }
 
-  memcpy(buf, data, length);
-  m_currentPlayingRecordPosition += length;
+  TransmitPipelined(requests, responses, STATE_PREFETCH);
 
-  delete vresp;
-  return length;
+  MutexLock lock(&m_recstatelock);
+
+  for (size_t i = 0; i < requests.size(); i++)
+  {
+    delete requests[i];
+
+    if (responses[i] == NULL)
+      continue;
+
+    // don't overwrite a position set meanwhile
+    if (!responses[i]->eop() && m_recpositions.find(missing[i]) == m_recpositions.end())
+      m_recpositions[missing[i]] = responses[i]->get_S64();
+
+    delete responses[i];
+  }
 }
 
-long long Connection::SeekRecording(long long pos, uint32_t whence)
+void Connection::FlushRecordingState()
 {
-  MutexLock lock(&m_cmdlock);
-  uint64_t nextPos = m_currentPlayingRecordPosition;
+  std::map<std::string, int64_t> positions;
+  std::map<std::string, int> playcounts;
 
-  switch (whence)
   {
-    case SEEK_SET:
-      nextPos = pos;
-      break;
+    MutexLock lock(&m_recstatelock);
+    positions.swap(m_recdirtypositions);
+    playcounts.swap(m_recdirtyplaycounts);
+  }
 
-    case SEEK_CUR:
-      nextPos += pos;
-      break;
+  if (positions.empty() && playcounts.empty())
+    return;
 
-    case SEEK_END:
-      nextPos = m_currentPlayingRecordBytes + pos;
-      break;
+  std::vector<MsgPacket*> requests;
+  std::vector<MsgPacket*> responses;
 
-    case SEEK_POSSIBLE:
-      return 1;
+  for (std::map<std::string, int64_t>::iterator i = positions.begin(); i != positions.end(); i++)
+  {
+    MsgPacket* vrp = new MsgPacket(XVDR_RECORDINGS_SETPOSITION);
+    vrp->put_String(i->first.c_str());
+    vrp->put_S64(i->second);
+    requests.push_back(vrp);
+  }
 
-    default:
-      return -1;
+  for (std::map<std::string, int>::iterator i = playcounts.begin(); i != playcounts.end(); i++)
+  {
+    MsgPacket* vrp = new MsgPacket(XVDR_RECORDINGS_SETPLAYCOUNT);
+    vrp->put_String(i->first.c_str());
+    vrp->put_U32(i->second);
+    requests.push_back(vrp);
   }
 
-  if (nextPos > m_currentPlayingRecordBytes)
-    return -1;
+  TransmitPipelined(requests, responses, STATE_PREFETCH);
 
-  m_currentPlayingRecordPosition = nextPos;
+  // requests without a response are tried again, rejected ones are not
+  std::map<std::string, int64_t> failedpositions;
+  std::map<std::string, int> failedplaycounts;
+  int rejected = 0;
+  size_t n = 0;
 
-  return m_currentPlayingRecordPosition;
-}
+  for (std::map<std::string, int64_t>::iterator i = positions.begin(); i != positions.end(); i++, n++)
+  {
+    if (responses[n] == NULL)
+      failedpositions.insert(*i);
+    else if (responses[n]->eop() || responses[n]->get_U32() != XVDR_RET_OK)
+      rejected++;
+  }
 
-long long Connection::RecordingPosition(void)
-{
-  MutexLock lock(&m_cmdlock);
-  return m_currentPlayingRecordPosition;
-}
+  for (std::map<std::string, int>::iterator i = playcounts.begin(); i != playcounts.end(); i++, n++)
+  {
+    if (responses[n] == NULL)
+      failedplaycounts.insert(*i);
+    else if (responses[n]->eop() || responses[n]->get_U32() != XVDR_RET_OK)
+      rejected++;
+  }
 
-long long Connection::RecordingLength(void)
-{
-  MutexLock lock(&m_cmdlock);
-  return m_currentPlayingRecordBytes;
-}
+  for (size_t i = 0; i < requests.size(); i++)
+  {
+    delete requests[i];
+    delete responses[i];
+  }
 
-bool Connection::LoadRecordingEdl(const std::string& recid, RecordingEdl& edl)
-{
-  MsgPacket vrp(XVDR_RECORDINGS_GETMARKS);
-  vrp.put_String(recid.c_str());
+  int failed = (int)(failedpositions.size() + failedplaycounts.size());
 
-  MsgPacket* vresp = ReadResult(&vrp);
+  m_client->Log(DEBUG, "%s - %i positions, %i play counts written (%i failed, %i rejected)", __FUNCTION__, (int)positions.size(), (int)playcounts.size(), failed, rejected);
 
-  if (vresp == NULL || vresp->eop()) {
-    delete vresp;
-    return false;
-  }
+  if (rejected > 0)
+    m_client->Log(FAILURE, "%s - server rejected %i resume points or play counts", __FUNCTION__, rejected);
 
-  if(vresp->get_U32() != XVDR_RET_OK) {
-    delete vresp;
-    return false;
-  }
+  int attempts = 0;
 
-  double fps = (double)vresp->get_U64() / 10000.0;
+  {
+    MutexLock lock(&m_recstatelock);
 
-  while(!vresp->eop()) {
-    RecordingCutMark mark(vresp);
-    mark.Fps = fps;
-    edl.push_back(mark);
+    if (failed == 0)
+    {
+      m_recstateattempts = 0;
+      return;
+    }
+
+    if (++m_recstateattempts >= STATE_ATTEMPTS)
+    {
+      m_client->Log(FAILURE, "%s - giving up on %i resume points or play counts after %i attempts", __FUNCTION__, failed, m_recstateattempts);
+      m_recstateattempts = 0;
+      return;
+    }
+
+    // try again later, newer values win
+    m_recdirtypositions.insert(failedpositions.begin(), failedpositions.end());
+    m_recdirtyplaycounts.insert(failedplaycounts.begin(), failedplaycounts.end());
+    attempts = m_recstateattempts;
   }
 
-  return true;
+  ScheduleTasks(TASK_FLUSH, STATE_FLUSHDELAY * attempts);
 }
 
 bool Connection::TryReconnect() {
@@ -977,50 +2794,56 @@ void Connection::SetAudioType(int type)
 
 bool Connection::SetRecordingPlayCount(const std::string& recid, int count)
 {
-  MutexLock lock(&m_cmdlock);
+  // it couldn't be written any time soon
+  if (ConnectionLost())
+    return false;
 
-  MsgPacket vrp(XVDR_RECORDINGS_SETPLAYCOUNT);
-  vrp.put_String(recid.c_str());
-  vrp.put_U32(count);
+  m_recindex->SetPlayCount(recid, count);
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL)
   {
-    delete vresp;
-    return false;
+    MutexLock lock(&m_recstatelock);
+    m_recdirtyplaycounts[recid] = count;
   }
 
-  delete vresp;
+  ScheduleTasks(TASK_FLUSH, STATE_FLUSHDELAY);
   return true;
 }
 
 bool Connection::SetRecordingLastPosition(const std::string& recid, int64_t pos)
 {
-  MutexLock lock(&m_cmdlock);
-
-  MsgPacket vrp(XVDR_RECORDINGS_SETPOSITION);
-  vrp.put_String(recid.c_str());
-  vrp.put_S64(pos);
+  if (ConnectionLost())
+    return false;
 
-  MsgPacket* vresp = ReadResult(&vrp);
-  if (vresp == NULL)
   {
-    delete vresp;
-    return false;
+    MutexLock lock(&m_recstatelock);
+    m_recpositions[recid] = pos;
+    m_recdirtypositions[recid] = pos;
   }
 
-  delete vresp;
+  ScheduleTasks(TASK_FLUSH, STATE_FLUSHDELAY);
   return true;
 }
 
 int64_t Connection::GetRecordingLastPosition(const std::string& recid)
 {
-  MutexLock lock(&m_cmdlock);
+  {
+    MutexLock lock(&m_recstatelock);
+    std::map<std::string, int64_t>::iterator i = m_recpositions.find(recid);
+
+    if (i != m_recpositions.end())
+      return i->second;
+  }
 
   MsgPacket vrp(XVDR_RECORDINGS_GETPOSITION);
   vrp.put_String(recid.c_str());
 
-  MsgPacket* vresp = ReadResult(&vrp);
+  MsgPacket* vresp = NULL;
+
+  {
+    MutexLock lock(&m_cmdlock);
+    vresp = ReadResult(&vrp);
+  }
+
   if (vresp == NULL || vresp->eop())
   {
     delete vresp;
@@ -1030,6 +2853,9 @@ int64_t Connection::GetRecordingLastPosition(const std::string& recid)
   int64_t pos = vresp->get_S64();
   delete vresp;
 
+  MutexLock lock(&m_recstatelock);
+  m_recpositions.insert(std::make_pair(recid, pos));
+
   return pos;
 }
 
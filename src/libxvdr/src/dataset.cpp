@@ -50,6 +50,38 @@ EpgItem& XVDR::operator<< (EpgItem& lhs, MsgPacket* rhs) {
   return lhs;
 }
 
+MsgPacket& XVDR::operator<< (MsgPacket& lhs, const EpgItem& rhs) {
+  lhs.put_U32(rhs.BroadcastID);
+  lhs.put_U32(rhs.StartTime);
+  lhs.put_U32(rhs.EndTime - rhs.StartTime);
+  lhs.put_U32(rhs.GenreType | rhs.GenreSubType);
+  lhs.put_U32(rhs.ParentalRating);
+  lhs.put_String(rhs.Title.c_str());
+  lhs.put_String(rhs.PlotOutline.c_str());
+  lhs.put_String(rhs.Plot.c_str());
+
+  return lhs;
+}
+
+
+EpgItemRef::EpgItemRef() : UID(0), BroadcastID(0), StartTime(0), EndTime(0), GenreType(0), GenreSubType(0), ParentalRating(0), Title(""), PlotOutline(""), Plot("") {
+}
+
+EpgItem& XVDR::operator<< (EpgItem& lhs, const EpgItemRef& rhs) {
+  lhs.UID = rhs.UID;
+  lhs.BroadcastID = rhs.BroadcastID;
+  lhs.StartTime = rhs.StartTime;
+  lhs.EndTime = rhs.EndTime;
+  lhs.GenreType = rhs.GenreType;
+  lhs.GenreSubType = rhs.GenreSubType;
+  lhs.ParentalRating = rhs.ParentalRating;
+  lhs.Title = rhs.Title;
+  lhs.PlotOutline = rhs.PlotOutline;
+  lhs.Plot = rhs.Plot;
+
+  return lhs;
+}
+
 
 Channel::Channel() : UID(0), Number(0), EncryptionSystem(0), IsHidden(false), IsRadio(false) {
 }
@@ -171,6 +203,7 @@ MsgPacket& XVDR::operator<< (MsgPacket& lhs, const Timer& rhs) {
 RecordingEntry::RecordingEntry() {
   Time = 0;
   Duration = 0;
+  Priority = 0;
   LifeTime = 0;
   GenreType = 0;
   GenreSubType = 0;
@@ -204,6 +237,64 @@ RecordingEntry& XVDR::operator<< (RecordingEntry& lhs, MsgPacket* rhs) {
   return lhs;
 }
 
+MsgPacket& XVDR::operator<< (MsgPacket& lhs, const RecordingEntry& rhs) {
+  lhs.put_U32(rhs.Time);
+  lhs.put_U32(rhs.Duration);
+  lhs.put_U32(rhs.Priority);
+  lhs.put_U32(rhs.LifeTime);
+  lhs.put_String(rhs.ChannelName.c_str());
+  lhs.put_String(rhs.Title.c_str());
+  lhs.put_String(rhs.PlotOutline.c_str());
+  lhs.put_String(rhs.Plot.c_str());
+  lhs.put_String(rhs.Directory.c_str());
+  lhs.put_String(rhs.Id.c_str());
+  lhs.put_U32(rhs.PlayCount);
+  lhs.put_U32(rhs.GenreType | rhs.GenreSubType);
+  lhs.put_String(rhs.ThumbNailPath.c_str());
+  lhs.put_String(rhs.IconPath.c_str());
+
+  return lhs;
+}
+
+
+RecordingEntryRef::RecordingEntryRef() {
+  Time = 0;
+  Duration = 0;
+  Priority = 0;
+  LifeTime = 0;
+  ChannelName = "";
+  Title = "";
+  PlotOutline = "";
+  Plot = "";
+  Directory = "";
+  Id = "";
+  GenreType = 0;
+  GenreSubType = 0;
+  PlayCount = 0;
+  ThumbNailPath = "";
+  IconPath = "";
+}
+
+RecordingEntry& XVDR::operator<< (RecordingEntry& lhs, const RecordingEntryRef& rhs) {
+  lhs.Time = rhs.Time;
+  lhs.Duration = rhs.Duration;
+  lhs.Priority = rhs.Priority;
+  lhs.LifeTime = rhs.LifeTime;
+  lhs.ChannelName = rhs.ChannelName;
+  lhs.Title = rhs.Title;
+  lhs.PlotOutline = rhs.PlotOutline;
+  lhs.Plot = rhs.Plot;
+  lhs.Directory = rhs.Directory;
+  lhs.Id = rhs.Id;
+  lhs.GenreType = rhs.GenreType;
+  lhs.GenreSubType = rhs.GenreSubType;
+  lhs.PlayCount = rhs.PlayCount;
+  lhs.ThumbNailPath = rhs.ThumbNailPath;
+  lhs.IconPath = rhs.IconPath;
+
+  return lhs;
+}
+
 RecordingCutMark::RecordingCutMark() {
   Fps = 0;
   FrameBegin = 0;
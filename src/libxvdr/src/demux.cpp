@@ -27,16 +27,23 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
+#include <vector>
 
 #include "xvdr/demux.h"
 #include "xvdr/msgpacket.h"
 #include "xvdr/command.h"
+#include "xvdr/frameparser.h"
+
+#include "iso639.h"
+
+#define LIVE_JUMP 30000 // ms the live edge may seem to move back before it counts as a timestamp jump
 
 using namespace XVDR;
 
 Demux::Demux(ClientInterface* client, PacketBuffer* buffer) : Connection(client), m_priority(50),
-    m_queuelocked(false), m_paused(false), m_timeshiftmode(false), m_channeluid(0), m_buffer(buffer),
-    m_iframestart(false)
+    m_queuelocked(false), m_interrupted(false), m_paused(false), m_timeshiftmode(false), m_channeluid(0), m_buffer(buffer),
+    m_iframestart(false), m_requested(0), m_requestwindow(32),
+    m_filter(SF_NONE), m_catchup(0), m_livevalid(false), m_liveorigin(0), m_readpts(-1)
 {
 }
 
@@ -52,16 +59,50 @@ Demux::~Demux()
 
 Demux::SwitchStatus Demux::OpenChannel(const std::string& hostname, uint32_t channeluid)
 {
-  if(!Open(hostname))
-    return SC_ERROR;
+  // reuse the logged-in session if it is still alive
+  if(!IsOpen() || ConnectionLost() || Aborting() || hostname != m_hostname)
+  {
+    if(!Open(hostname))
+      return SC_ERROR;
+
+    SyncClock();
+  }
+
+  KeepClockSynced(true);
 
-  m_paused = false;
-  m_timeshiftmode = false;
+  {
+    MutexLock lock(&m_lock);
+    m_interrupted = false;
+    m_paused = false;
+    m_timeshiftmode = false;
+  }
 
   return SwitchChannel(channeluid);
 }
 
 void Demux::CloseChannel() {
+  KeepClockSynced(false);
+
+  {
+    MutexLock lock(&m_lock);
+    m_queuelocked = true;
+  }
+
+  CleanupPacketQueue();
+  m_cond.Signal();
+
+  // keep the session open, the server just stops streaming
+  if(IsOpen() && !ConnectionLost() && !Aborting())
+  {
+    MsgPacket vrp(XVDR_CHANNELSTREAM_CLOSE);
+    MsgPacket* vresp = ReadResult(&vrp);
+    delete vresp;
+  }
+
+  MutexLock lock(&m_lock);
+  m_streams.clear();
+  m_channeluid = 0;
+  m_interrupted = false;
 }
 
 StreamProperties Demux::GetStreamProperties()
@@ -78,13 +119,10 @@ void Demux::CleanupPacketQueue()
     m_buffer->clear();
   }
 
-  Packet* p = NULL;
-
   while(!m_queue.empty())
   {
-    p = m_queue.front();
+    m_client->FreePacket(m_queue.front().packet);
     m_queue.pop();
-    m_client->FreePacket(p);
   }
 }
 
@@ -96,6 +134,17 @@ void Demux::Abort()
   m_cond.Signal();
 }
 
+void Demux::Interrupt()
+{
+  {
+    MutexLock lock(&m_lock);
+    m_interrupted = true;
+  }
+
+  CleanupPacketQueue();
+  m_cond.Signal();
+}
+
 Packet* Demux::Read()
 {
   if(ConnectionLost() || Aborting()) {
@@ -106,6 +155,11 @@ Packet* Demux::Read()
   MsgPacket* pkt = NULL;
   m_lock.Lock();
 
+  if(m_interrupted) {
+      m_lock.Unlock();
+      return NULL;
+  }
+
   if(m_queuelocked) {
       m_lock.Unlock();
       return m_client->AllocatePacket(0);
@@ -139,6 +193,9 @@ Packet* Demux::Read()
         } else {
           p = m_client->AllocatePacket(length);
           m_client->SetPacketData(p, payload, stream.Index, dts, pts, duration);
+
+          if (pts >= 0)
+            m_readpts = pts;
         }
         break;
       }
@@ -160,29 +217,36 @@ Packet* Demux::Read()
     return p;
   }
 
+  m_lock.Unlock();
+
+  // keep the request window filled in timeshift mode
+  if(!RequestPackets())
+    return NULL;
+
+  m_lock.Lock();
   bool bEmpty = m_queue.empty();
 
   // empty queue -> wait for packet
   if (bEmpty) {
          m_lock.Unlock();
 
-         // request packets in timeshift mode
-         if(m_timeshiftmode)
-         {
-           MsgPacket req(XVDR_CHANNELSTREAM_REQUEST, XVDR_CHANNEL_STREAM);
-           if(!Session::TransmitMessage(&req))
-             return NULL;
-         }
-
-         m_cond.Wait(1000);
+         bool signaled = m_cond.Wait(1000);
 
          m_lock.Lock();
          bEmpty = m_queue.empty();
+
+         // outstanding requests got lost, start over with a full window
+         if(!signaled && bEmpty)
+           m_requested = 0;
   }
 
   if (!bEmpty)
   {
-    p = m_queue.front();
+    p = m_queue.front().packet;
+
+    if(m_queue.front().pts >= 0)
+      m_readpts = m_queue.front().pts;
+
     m_queue.pop();
   }
 
@@ -205,7 +269,17 @@ bool Demux::OnResponsePacket(MsgPacket *resp) {
   if (resp->getType() != XVDR_CHANNEL_STREAM)
     return false;
 
+  // each requested packet returns one credit
+  if (resp->getMsgID() == XVDR_STREAM_MUXPKT || resp->getMsgID() == XVDR_STREAM_CHANGE)
+  {
+    MutexLock lock(&m_lock);
+    if(m_requested > 0)
+      m_requested--;
+  }
+
   Packet* pkt = NULL;
+  int64_t pktpts = -1;
+  bool keyframe = false;
   int iStreamId = -1;
 
   switch (resp->getMsgID())
@@ -216,6 +290,15 @@ bool Demux::OnResponsePacket(MsgPacket *resp) {
       break;
 
     case XVDR_STREAM_CHANGE:
+      if (m_filter != SF_NONE || m_buffer != NULL) {
+        StreamProperties streams;
+        ParseStreams(resp, streams);
+        resp->rewind();
+
+        MutexLock lock(&m_lock);
+        m_livestreams = streams;
+      }
+
       if (m_buffer != NULL) {
         m_lock.Lock();
         m_buffer->put(resp);
@@ -238,16 +321,33 @@ bool Demux::OnResponsePacket(MsgPacket *resp) {
 
     case XVDR_STREAM_MUXPKT:
       {
+        // figure out the stream for this packet
+        uint16_t id = resp->get_U16();
+
+        // drop unwanted streams before they get buffered or copied
+        if(!StreamSelected(id))
+          break;
+
         if (m_buffer != NULL) {
+          ClassifyFrame(resp, id);
+          resp->rewind();
+
+          // keep track of the live edge
+          resp->get_U16();
+          int64_t pts = resp->get_S64();
+          resp->rewind();
+
+          int64_t servertime = GetServerTime();
           m_lock.Lock();
+
+          LivePacket(pts, servertime);
+
           m_buffer->put(resp);
           m_lock.Unlock();
           m_cond.Signal();
           return true;
         }
 
-        // figure out the stream for this packet
-        uint16_t id = resp->get_U16();
         Stream& stream = m_streams[id];
 
         if(stream.PhysicalId != id) {
@@ -262,6 +362,11 @@ bool Demux::OnResponsePacket(MsgPacket *resp) {
         uint8_t* payload = resp->consume(length);
         pkt = m_client->AllocatePacket(length);
         m_client->SetPacketData(pkt, payload, stream.Index, dts, pts, duration);
+        pktpts = pts;
+
+        // keyframes are the only safe points to catch up with live
+        if (m_catchup > 0 && stream.Content == "VIDEO")
+          keyframe = (FrameParser::GetFrameType(FrameParser::GetCodec(stream.Type), payload, length) == FrameParser::FT_IFRAME);
       }
       break;
 
@@ -272,9 +377,26 @@ bool Demux::OnResponsePacket(MsgPacket *resp) {
   }
 
   if(pkt != NULL) {
+	  // taken before the lock, the clock is guarded by the connection
+	  int64_t servertime = GetServerTime();
+
 	  {
 	    MutexLock lock(&m_lock);
 
+	    LivePacket(pktpts, servertime);
+
+	    // player fell behind live -> skip forward to this keyframe
+	    if(keyframe && !m_timeshiftmode && !m_queue.empty() && LiveLatency(servertime) > m_catchup)
+	    {
+	      m_client->Log(INFO, "live latency %i ms, skipping %i queued packets", LiveLatency(servertime), (int)m_queue.size());
+
+	      while(!m_queue.empty())
+	      {
+	        m_client->FreePacket(m_queue.front().packet);
+	        m_queue.pop();
+	      }
+	    }
+
 	    // limit queue size
 	    if(m_queue.size() > 200)
 	    {
@@ -282,7 +404,8 @@ bool Demux::OnResponsePacket(MsgPacket *resp) {
 	      return false;
 	    }
 
-      m_queue.push(pkt);
+      QueuedPacket item = { pkt, pktpts };
+      m_queue.push(item);
 	  }
 	  m_cond.Signal();
   }
@@ -312,10 +435,16 @@ Demux::SwitchStatus Demux::SwitchChannel(uint32_t channeluid)
   {
     MutexLock lock(&m_lock);
     m_queuelocked = false;
+    m_interrupted = false;
     m_paused = false;
     m_timeshiftmode = false;
+    m_requested = 0;
 
     m_streams.clear();
+    m_livestreams.clear();
+
+    m_livevalid = false;
+    m_readpts = -1;
   }
 
   SwitchStatus status = SC_OK;
@@ -377,17 +506,22 @@ void Demux::GetContentFromType(const std::string& type, std::string& content) {
 void Demux::StreamChange(MsgPacket *resp)
 {
   MutexLock lock(&m_lock);
-  m_streams.clear();
+  ParseStreams(resp, m_streams);
+}
 
-  int index = 0;
+void Demux::ParseStreams(MsgPacket *resp, StreamProperties& streams)
+{
+  streams.clear();
+
+  std::vector<Stream> list;
   uint32_t composition_id;
   uint32_t ancillary_id;
+  bool preferred = false;
 
   while (!resp->eop())
   {
     Stream stream;
 
-    stream.Index = index++;
     stream.PhysicalId = resp->get_U32();
     stream.Type = resp->get_String();
 
@@ -402,6 +536,7 @@ void Demux::StreamChange(MsgPacket *resp)
       stream.BlockAlign = resp->get_U32();
       stream.BitRate = resp->get_U32();
       stream.BitsPerSample = resp->get_U32();
+      preferred |= (stream.Language == m_language);
     }
     else if(stream.Content == "VIDEO") {
       stream.FpsScale = resp->get_U32();
@@ -417,13 +552,41 @@ void Demux::StreamChange(MsgPacket *resp)
       stream.Identifier = (composition_id & 0xffff) | ((ancillary_id & 0xffff) << 16);
     }
 
+    list.push_back(stream);
+  }
+
+  int index = 0;
+  bool firstaudio = true;
+
+  for(std::vector<Stream>::iterator i = list.begin(); i != list.end(); i++)
+  {
+    Stream& stream = *i;
+
+    // apply stream filter (keep the first audio stream if none matches the language)
+    if(stream.Content == "AUDIO" && (m_filter & SF_PREFERRED_AUDIO)) {
+      bool skip = preferred ? (stream.Language != m_language) : !firstaudio;
+      firstaudio = false;
+
+      if(skip) {
+        continue;
+      }
+    }
+    else if(stream.Content == "SUBTITLE" && (m_filter & SF_NO_SUBTITLES)) {
+      continue;
+    }
+    else if(stream.Content == "TELETEXT" && (m_filter & SF_NO_TELETEXT)) {
+      continue;
+    }
+
+    stream.Index = index++;
+
     if (index > 16)
     {
       m_client->Log(FAILURE, "%s - max amount of streams reached", __FUNCTION__);
       break;
     }
 
-    m_streams[stream.PhysicalId] = stream;
+    streams[stream.PhysicalId] = stream;
   }
 }
 
@@ -484,11 +647,151 @@ void Demux::Pause(bool on)
       m_timeshiftmode = true;
 
     m_paused = on;
+    m_requested = 0;
   }
 
   m_cond.Signal();
 }
 
+bool Demux::RequestPackets()
+{
+  int count = 0;
+
+  {
+    MutexLock lock(&m_lock);
+
+    if(!m_timeshiftmode)
+      return true;
+
+    // refill the window once half of it has been consumed
+    int pending = m_requested + (int)m_queue.size();
+
+    if(pending > m_requestwindow / 2)
+      return true;
+
+    count = m_requestwindow - pending;
+    m_requested += count;
+  }
+
+  for(int i = 0; i < count; i++)
+  {
+    MsgPacket req(XVDR_CHANNELSTREAM_REQUEST, XVDR_CHANNEL_STREAM);
+    if(!Session::TransmitMessage(&req))
+    {
+      MutexLock lock(&m_lock);
+      m_requested -= (count - i);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Demux::StreamSelected(uint32_t physicalid)
+{
+  MutexLock lock(&m_lock);
+
+  if(m_filter == SF_NONE)
+    return true;
+
+  return (m_livestreams.find(physicalid) != m_livestreams.end());
+}
+
+void Demux::ClassifyFrame(MsgPacket *resp, uint32_t physicalid)
+{
+  FrameParser::Codec codec = FrameParser::CODEC_UNKNOWN;
+
+  {
+    MutexLock lock(&m_lock);
+    StreamProperties::iterator i = m_livestreams.find(physicalid);
+
+    if(i != m_livestreams.end())
+      codec = FrameParser::GetCodec(i->second.Type);
+  }
+
+  if(codec == FrameParser::CODEC_UNKNOWN)
+    return;
+
+  resp->get_S64(); // pts
+  resp->get_S64(); // dts
+  resp->get_U32(); // duration
+  uint32_t length = resp->get_U32();
+  uint8_t* payload = resp->consume(length);
+
+  if(payload == NULL)
+    return;
+
+  // store the frametype in the lower byte of the client id (used for seeking)
+  FrameParser::FrameType type = FrameParser::GetFrameType(codec, payload, length);
+
+  if(type != FrameParser::FT_UNKNOWN)
+    resp->setClientID((resp->getClientID() & 0xFF00) | type);
+}
+
+void Demux::SetCatchUp(int ms)
+{
+  MutexLock lock(&m_lock);
+  m_catchup = (ms < 0) ? 0 : ms;
+}
+
+int Demux::GetLiveLatency()
+{
+  int64_t servertime = GetServerTime();
+
+  MutexLock lock(&m_lock);
+  return LiveLatency(servertime);
+}
+
+void Demux::LivePacket(int64_t pts, int64_t servertime)
+{
+  if(pts < 0)
+    return;
+
+  // server time when this timestamp was live. a packet can't arrive before
+  // it left the server, so the earliest arrival marks the live edge.
+  // packets held up on the way or in the server's buffer arrive later.
+  int64_t origin = servertime - pts / 1000;
+
+  if(!m_livevalid || origin > m_liveorigin || origin < m_liveorigin - LIVE_JUMP)
+  {
+    m_liveorigin = origin;
+    m_livevalid = true;
+  }
+}
+
+int Demux::LiveLatency(int64_t servertime)
+{
+  if(!m_livevalid || m_readpts < 0)
+    return 0;
+
+  // server time now minus the server time when the packet last read was live
+  int64_t latency = servertime - (m_liveorigin + m_readpts / 1000);
+
+  return (latency < 0) ? 0 : (int)latency;
+}
+
+void Demux::SetStreamFilter(int filter)
+{
+  const char* lang = ISO639_FindLanguage(m_client->GetLanguageCode());
+
+  MutexLock lock(&m_lock);
+  m_filter = filter;
+  m_language = (lang != NULL) ? lang : "";
+
+  // without a known language there is no preferred audio stream
+  if(m_language.empty())
+    m_filter &= ~SF_PREFERRED_AUDIO;
+}
+
+void Demux::SetRequestWindow(int packets)
+{
+  if(packets < 1 || packets > 200)
+    packets = 32;
+
+  MutexLock lock(&m_lock);
+  m_requestwindow = packets;
+}
+
 void Demux::RequestSignalInfo()
 {
   if(!m_lastsignal.TimedOut())
@@ -0,0 +1,250 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <time.h>
+#include <algorithm>
+
+#include "xvdr/clientinterface.h"
+#include "xvdr/command.h"
+#include "xvdr/connection.h"
+#include "xvdr/dataset.h"
+#include "xvdr/msgpacket.h"
+#include "xvdr/session.h"
+
+#include "epgprefetch.h"
+#include "epgstore.h"
+#include "iso639.h"
+#include "responsecache.h"
+
+using namespace XVDR;
+
+#define PREFETCH_IDLE 1000 // ms without requests on the connection before the guide is loaded
+#define PREFETCH_RETRY 30000 // ms before the first retry after a failed login, doubled on each failure
+#define PREFETCH_RETRYMAX (30 * 60 * 1000) // longest pause between two logins
+
+// session reading the guide next to the connection
+class EpgSession : public Session {
+public:
+
+  EpgSession(int timeout_ms) {
+    m_timeout = timeout_ms;
+  }
+
+  bool Login(const std::string& hostname, const std::string& name, const std::string& language, uint16_t protocol) {
+    if(!Open(hostname)) {
+      m_error = "unable to connect";
+      return false;
+    }
+
+    const char* lang = ISO639_FindLanguage(language);
+
+    // the guide is read uncompressed, in parts while it arrives
+    MsgPacket login(XVDR_LOGIN);
+    login.setProtocolVersion(XVDRPROTOCOLVERSION);
+    login.put_U8(0);
+    login.put_String(name.c_str());
+    login.put_String((lang != NULL) ? lang : "");
+    login.put_U8(0);
+
+    MsgPacket* vresp = ReadResult(&login);
+
+    if(vresp == NULL) {
+      m_error = "no greeting from the server";
+      return false;
+    }
+
+    // the same server the connection is logged in to
+    uint16_t version = vresp->getProtocolVersion();
+    vresp->get_U32();
+    vresp->get_S32();
+    m_server = vresp->get_String();
+    m_version = vresp->get_String();
+
+    bool ok = (version == protocol);
+    delete vresp;
+
+    if(!ok) {
+      m_error = "unexpected protocol version";
+    }
+
+    return ok;
+  }
+
+  std::string m_error;
+  std::string m_server;
+  std::string m_version;
+};
+
+// sorts channels by the number of switches
+class MoreWatched {
+public:
+
+  MoreWatched(std::map<uint32_t, int>& watched) : m_watched(watched) {
+  }
+
+  bool operator()(uint32_t a, uint32_t b) const {
+    return Count(a) > Count(b);
+  }
+
+private:
+
+  int Count(uint32_t channeluid) const {
+    std::map<uint32_t, int>::const_iterator i = m_watched.find(channeluid);
+    return (i != m_watched.end()) ? i->second : 0;
+  }
+
+  std::map<uint32_t, int>& m_watched;
+};
+
+EpgPrefetch::EpgPrefetch(Connection* connection, int hours, int interval_ms) : m_connection(connection), m_session(NULL), m_hours(hours), m_interval(interval_ms), m_next(0), m_failures(0) {
+  if(m_interval < 1) {
+    m_interval = 1;
+  }
+}
+
+EpgPrefetch::~EpgPrefetch() {
+  Cancel(-1);
+  m_event.Signal();
+  Cancel(5);
+
+  delete m_session;
+}
+
+void EpgPrefetch::Watched(uint32_t channeluid) {
+  MutexLock lock(&m_lock);
+  m_watched[channeluid]++;
+}
+
+void EpgPrefetch::Action() {
+  while(Running()) {
+    m_event.Wait(RetryDelay());
+
+    // leave the server to the foreground requests
+    if(!Running() || !m_connection->Idle(PREFETCH_IDLE)) {
+      continue;
+    }
+
+    // the current and the next full hours
+    uint32_t start = time(NULL);
+    start -= start % 3600;
+    uint32_t end = start + (m_hours + 1) * 3600;
+
+    uint32_t channeluid = 0;
+
+    if(!Next(start, end, channeluid) || (m_session == NULL && !OpenSession())) {
+      continue;
+    }
+
+    // a late response would be taken for the next one, start over
+    if(!m_connection->FetchEpg(m_session, channeluid, start, end)) {
+      delete m_session;
+      m_session = NULL;
+    }
+  }
+}
+
+bool EpgPrefetch::Next(uint32_t start, uint32_t end, uint32_t& channeluid) {
+  // a new walk after the last one, in the order of popularity
+  if(m_next >= m_channels.size()) {
+    GetChannels(m_channels);
+    m_next = 0;
+  }
+
+  while(m_next < m_channels.size()) {
+    std::vector<EpgStore::Range> missing;
+    channeluid = m_channels[m_next++];
+
+    m_connection->m_epgstore->GetMissing(channeluid, start, end, missing);
+
+    if(!missing.empty()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void EpgPrefetch::GetChannels(std::vector<uint32_t>& channels) {
+  channels.clear();
+
+  // the channels XBMC got, TV first
+  for(uint32_t radio = 0; radio < 2; radio++) {
+    MsgPacket request(XVDR_CHANNELS_GETCHANNELS);
+    request.put_U32(radio);
+
+    MsgPacket* list = m_connection->m_channelcache->Get(&request);
+
+    if(list == NULL) {
+      continue;
+    }
+
+    while(!list->eop()) {
+      Channel channel(list);
+      channels.push_back(channel.UID);
+    }
+
+    delete list;
+  }
+
+  MutexLock lock(&m_lock);
+  std::stable_sort(channels.begin(), channels.end(), MoreWatched(m_watched));
+}
+
+int EpgPrefetch::RetryDelay() {
+  if(m_failures == 0) {
+    return m_interval;
+  }
+
+  int delay = PREFETCH_RETRY;
+
+  for(int i = 1; i < m_failures && delay < PREFETCH_RETRYMAX; i++) {
+    delay *= 2;
+  }
+
+  return std::min(delay, PREFETCH_RETRYMAX);
+}
+
+bool EpgPrefetch::OpenSession() {
+  ClientInterface* client = m_connection->m_client;
+  EpgSession* session = new EpgSession(m_connection->m_timeout);
+  std::string name = (m_connection->m_name.empty() ? "XVDR Client" : m_connection->m_name) + " (epg)";
+
+  if(!session->Login(m_connection->m_hostname, name, client->GetLanguageCode(), m_connection->m_protocol)) {
+    // once per outage, the retries back off quietly
+    if(m_failures++ == 0) {
+      client->Log(FAILURE, "%s - unable to open the guide session (%s), retrying in the background", __FUNCTION__, session->m_error.c_str());
+    }
+
+    delete session;
+    return false;
+  }
+
+  if(m_failures > 0) {
+    client->Log(INFO, "%s - guide session to '%s' Version: '%s' reopened", __FUNCTION__, session->m_server.c_str(), session->m_version.c_str());
+  }
+
+  m_failures = 0;
+  m_session = session;
+  return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#include "xvdr/thread.h"
+
+namespace XVDR {
+
+class Connection;
+class Session;
+
+/**
+ * Background loader of the guide.
+ *
+ * Keeps the guide of the next hours in the EPG store of a connection, so
+ * XBMC's requests are answered locally. The guide is read on a plain session
+ * of its own (no reader thread, no status messages), one channel at a time
+ * with a pause in between, and only while the connection is idle. Channels
+ * watched more often come first. If the session can't be opened, the next
+ * logins are spaced out further after each failure.
+ */
+class EpgPrefetch : public Thread {
+public:
+
+  /**
+   * @param connection  connection holding the EPG store and the channel list
+   * @param hours       hours of the guide to keep loaded
+   * @param interval_ms pause between two channels
+   */
+  EpgPrefetch(Connection* connection, int hours, int interval_ms);
+  ~EpgPrefetch();
+
+  /**
+   * Count a channel switch.
+   */
+  void Watched(uint32_t channeluid);
+
+protected:
+
+  void Action();
+
+private:
+
+  bool Next(uint32_t start, uint32_t end, uint32_t& channeluid);
+
+  void GetChannels(std::vector<uint32_t>& channels);
+
+  int RetryDelay();
+
+  bool OpenSession();
+
+  Connection* m_connection;
+  Session* m_session;
+  int m_hours;
+  int m_interval;
+  std::vector<uint32_t> m_channels;
+  size_t m_next;
+  int m_failures;
+  std::map<uint32_t, int> m_watched;
+  Mutex m_lock;
+  CondWait m_event;
+};
+
+} // namespace XVDR
@@ -0,0 +1,376 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <fstream>
+
+#include "xvdr/msgpacket.h"
+#include "xvdr/command.h"
+#include "xvdr/clientinterface.h"
+#include "os-config.h"
+#include "epgstore.h"
+
+using namespace XVDR;
+
+// bump if the layout of the stored channels changes
+#define EPGSTORE_VERSION 1
+
+// events ended longer ago are dropped
+#define EPGSTORE_HISTORY (24 * 3600)
+
+EpgStore::EpgStore() : m_maxage(4 * 3600) {
+}
+
+bool EpgStore::SetFolder(const std::string& folder) {
+  MutexLock lock(&m_lock);
+
+  m_channels.clear();
+  m_strings.Clear();
+  m_folder = folder;
+
+  if(m_folder.empty()) {
+    return true;
+  }
+
+  ClientInterface::TrimPath(m_folder, true);
+  return os_mkdir(m_folder.c_str());
+}
+
+void EpgStore::SetMaxAge(uint32_t seconds) {
+  MutexLock lock(&m_lock);
+  m_maxage = seconds;
+}
+
+void EpgStore::GetMissing(uint32_t channeluid, uint32_t start, uint32_t end, std::vector<Range>& missing) {
+  MutexLock lock(&m_lock);
+
+  ChannelEpg& c = GetChannel(channeluid);
+  uint32_t now = time(NULL);
+  uint32_t pos = start;
+
+  // ranges are sorted and don't overlap
+  for(std::map<uint32_t, Fetched>::iterator i = c.ranges.begin(); i != c.ranges.end() && i->first < end; i++) {
+    if(i->second.end <= pos || i->second.time + m_maxage < now) {
+      continue;
+    }
+
+    if(i->first > pos) {
+      missing.push_back(Range(pos, i->first));
+    }
+
+    pos = i->second.end;
+  }
+
+  if(pos < end) {
+    missing.push_back(Range(pos, end));
+  }
+}
+
+void EpgStore::Update(uint32_t channeluid, uint32_t start, uint32_t end, MsgPacket* events) {
+  Batch batch;
+  Read(events, batch);
+  Commit(channeluid, start, end, batch);
+}
+
+void EpgStore::Read(MsgPacket* events, Batch& batch) {
+  MutexLock lock(&m_lock);
+
+  while(!events->eop()) {
+    batch.push_back(std::make_pair(0, Event()));
+    batch.back().first = Read(events, batch.back().second);
+  }
+}
+
+void EpgStore::Commit(uint32_t channeluid, uint32_t start, uint32_t end, Batch& batch) {
+  MutexLock lock(&m_lock);
+
+  ChannelEpg& c = GetChannel(channeluid);
+
+  // the response replaces everything starting in the range
+  Events::iterator i = c.events.lower_bound(start);
+
+  while(i != c.events.end() && i->first < end) {
+    Remove(c, i++);
+  }
+
+  for(Batch::iterator e = batch.begin(); e != batch.end(); e++) {
+    Replace(c, e->first, e->second);
+  }
+
+  batch.clear();
+
+  AddRange(c, start, end, time(NULL));
+  Save(channeluid, c);
+}
+
+void EpgStore::Release(Batch& batch) {
+  MutexLock lock(&m_lock);
+
+  for(Batch::iterator e = batch.begin(); e != batch.end(); e++) {
+    Release(e->second);
+  }
+
+  batch.clear();
+}
+
+void EpgStore::Transfer(ClientInterface* client, uint32_t channeluid, uint32_t start, uint32_t end) {
+  MutexLock lock(&m_lock);
+
+  ChannelEpg& c = GetChannel(channeluid);
+  std::vector<EpgItemRef> tags;
+
+  for(Events::iterator i = First(c, start); i != c.events.end() && i->first < end; i++) {
+    tags.push_back(EpgItemRef());
+    Unpack(channeluid, i, tags.back());
+  }
+
+  // the strings are passed straight from the pool, it's locked meanwhile
+  client->TransferEpgEntries(tags);
+}
+
+EpgStore::ChannelEpg& EpgStore::GetChannel(uint32_t channeluid) {
+  ChannelEpg& c = m_channels[channeluid];
+
+  if(!c.loaded) {
+    c.loaded = true;
+    Load(channeluid, c);
+  }
+
+  return c;
+}
+
+std::string EpgStore::GetFilename(uint32_t channeluid) {
+  char name[32];
+  sprintf(name, "epg-%08x.dat", channeluid);
+
+  return m_folder + name;
+}
+
+void EpgStore::Load(uint32_t channeluid, ChannelEpg& c) {
+  if(m_folder.empty()) {
+    return;
+  }
+
+  std::ifstream in(GetFilename(channeluid).c_str(), std::ios::in | std::ios::binary);
+
+  if(!in.is_open()) {
+    return;
+  }
+
+  MsgPacket p;
+
+  if(!MsgPacket::readstream(in, p) || p.getMsgID() != XVDR_EPG_GETFORCHANNEL || p.get_U32() != EPGSTORE_VERSION) {
+    return;
+  }
+
+  uint32_t count = p.get_U32();
+
+  for(uint32_t n = 0; n < count; n++) {
+    uint32_t start = p.get_U32();
+    c.ranges[start].end = p.get_U32();
+    c.ranges[start].time = p.get_U32();
+  }
+
+  while(!p.eop()) {
+    Event e;
+    uint32_t start = Read(&p, e);
+    Insert(c, start, e);
+  }
+
+  Expire(c);
+}
+
+void EpgStore::Save(uint32_t channeluid, ChannelEpg& c) {
+  if(m_folder.empty()) {
+    return;
+  }
+
+  Expire(c);
+
+  MsgPacket p(XVDR_EPG_GETFORCHANNEL);
+  p.put_U32(EPGSTORE_VERSION);
+  p.put_U32(c.ranges.size());
+
+  for(std::map<uint32_t, Fetched>::iterator i = c.ranges.begin(); i != c.ranges.end(); i++) {
+    p.put_U32(i->first);
+    p.put_U32(i->second.end);
+    p.put_U32(i->second.time);
+  }
+
+  for(Events::iterator i = c.events.begin(); i != c.events.end(); i++) {
+    Write(p, i);
+  }
+
+  std::ofstream out(GetFilename(channeluid).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+  if(!out.is_open()) {
+    return;
+  }
+
+  p.freeze();
+  out << p;
+}
+
+void EpgStore::Expire(ChannelEpg& c) {
+  uint32_t limit = time(NULL) - EPGSTORE_HISTORY;
+
+  while(!c.events.empty() && c.events.begin()->second.endtime < limit) {
+    Remove(c, c.events.begin());
+  }
+
+  while(!c.ranges.empty() && c.ranges.begin()->second.end < limit) {
+    c.ranges.erase(c.ranges.begin());
+  }
+}
+
+EpgStore::Events::iterator EpgStore::First(ChannelEpg& c, uint32_t start) {
+  Events::iterator i = c.events.upper_bound(start);
+
+  // include the event running at start
+  if(i != c.events.begin()) {
+    i--;
+
+    if(i->second.endtime <= start) {
+      i++;
+    }
+  }
+
+  return i;
+}
+
+uint32_t EpgStore::Read(MsgPacket* p, Event& e) {
+  // the layout of EpgItem
+  e.broadcastid = p->get_U32();
+  uint32_t start = p->get_U32();
+  e.endtime = start + p->get_U32();
+  uint32_t content = p->get_U32();
+  e.genretype = content & 0xF0;
+  e.genresubtype = content & 0x0F;
+  e.parentalrating = p->get_U32();
+  e.title = m_strings.Intern(p->get_String());
+  e.plotoutline = m_strings.Intern(p->get_String());
+  e.plot = m_strings.Intern(p->get_String());
+
+  return start;
+}
+
+void EpgStore::Write(MsgPacket& p, Events::const_iterator i) {
+  p.put_U32(i->second.broadcastid);
+  p.put_U32(i->first);
+  p.put_U32(i->second.endtime - i->first);
+  p.put_U32(i->second.genretype | i->second.genresubtype);
+  p.put_U32(i->second.parentalrating);
+  p.put_String(i->second.title);
+  p.put_String(i->second.plotoutline);
+  p.put_String(i->second.plot);
+}
+
+void EpgStore::Insert(ChannelEpg& c, uint32_t start, const Event& e) {
+  // not every server sends broadcast ids
+  if(e.broadcastid != 0) {
+    c.broadcasts[e.broadcastid] = start;
+  }
+
+  c.events[start] = e;
+}
+
+void EpgStore::Replace(ChannelEpg& c, uint32_t start, const Event& e) {
+  // the event may have moved
+  std::map<uint32_t, uint32_t>::iterator b = c.broadcasts.find(e.broadcastid);
+
+  if(b != c.broadcasts.end()) {
+    Remove(c, c.events.find(b->second));
+  }
+
+  Remove(c, c.events.find(start));
+  Insert(c, start, e);
+}
+
+void EpgStore::Remove(ChannelEpg& c, Events::iterator i) {
+  if(i == c.events.end()) {
+    return;
+  }
+
+  std::map<uint32_t, uint32_t>::iterator b = c.broadcasts.find(i->second.broadcastid);
+
+  if(b != c.broadcasts.end() && b->second == i->first) {
+    c.broadcasts.erase(b);
+  }
+
+  Release(i->second);
+  c.events.erase(i);
+}
+
+void EpgStore::Release(const Event& e) {
+  m_strings.Release(e.title);
+  m_strings.Release(e.plotoutline);
+  m_strings.Release(e.plot);
+}
+
+void EpgStore::Unpack(uint32_t channeluid, Events::const_iterator i, EpgItemRef& item) {
+  item.UID = channeluid;
+  item.BroadcastID = i->second.broadcastid;
+  item.StartTime = i->first;
+  item.EndTime = i->second.endtime;
+  item.GenreType = i->second.genretype;
+  item.GenreSubType = i->second.genresubtype;
+  item.ParentalRating = i->second.parentalrating;
+  item.Title = i->second.title;
+  item.PlotOutline = i->second.plotoutline;
+  item.Plot = i->second.plot;
+}
+
+void EpgStore::AddRange(ChannelEpg& c, uint32_t start, uint32_t end, uint32_t time) {
+  std::map<uint32_t, Fetched>::iterator i = c.ranges.upper_bound(start);
+
+  if(i != c.ranges.begin()) {
+    i--;
+  }
+
+  // cut the new range out of the overlapping ones
+  while(i != c.ranges.end() && i->first < end) {
+    uint32_t s = i->first;
+    Fetched f = i->second;
+
+    if(f.end <= start) {
+      i++;
+      continue;
+    }
+
+    c.ranges.erase(i++);
+
+    if(s < start) {
+      c.ranges[s].end = start;
+      c.ranges[s].time = f.time;
+    }
+
+    if(f.end > end) {
+      c.ranges[end] = f;
+    }
+  }
+
+  c.ranges[start].end = end;
+  c.ranges[start].time = time;
+}
@@ -0,0 +1,165 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "xvdr/dataset.h"
+#include "xvdr/thread.h"
+
+#include "stringpool.h"
+
+class MsgPacket;
+
+namespace XVDR {
+
+class ClientInterface;
+
+/**
+ * Local EPG store.
+ *
+ * Keeps the events of every channel sorted by start time together with
+ * the time ranges already fetched from the server, so a query only needs
+ * to fetch what is missing or outdated. Each channel is stored in a file
+ * of its own and loaded on first use. The strings of the events are kept
+ * in a pool, repeated titles and descriptions are stored once.
+ */
+class EpgStore {
+public:
+
+  typedef std::pair<uint32_t, uint32_t> Range;
+
+  // an event without the channel and the start time, the strings are in the pool
+  struct Event {
+    uint32_t broadcastid;
+    uint32_t endtime;
+    uint32_t parentalrating;
+    uint8_t genretype;
+    uint8_t genresubtype;
+    const char* title;
+    const char* plotoutline;
+    const char* plot;
+  };
+
+  // decoded events by start time, not stored yet
+  typedef std::vector< std::pair<uint32_t, Event> > Batch;
+
+  EpgStore();
+
+  /**
+   * Store the channels in a folder. If empty the store is kept in memory.
+   */
+  bool SetFolder(const std::string& folder);
+
+  /**
+   * Time in seconds a fetched range is considered up to date.
+   */
+  void SetMaxAge(uint32_t seconds);
+
+  /**
+   * Get the parts of [start, end) which must be fetched from the server.
+   */
+  void GetMissing(uint32_t channeluid, uint32_t start, uint32_t end, std::vector<Range>& missing);
+
+  /**
+   * Replace the events in [start, end) by a XVDR_EPG_GETFORCHANNEL response.
+   */
+  void Update(uint32_t channeluid, uint32_t start, uint32_t end, MsgPacket* events);
+
+  /**
+   * Update() in steps for a response received in parts: Read() decodes the
+   * events of a part, Commit() replaces the events starting in [start, end)
+   * by them and Release() drops them if the response turned out broken.
+   */
+  void Read(MsgPacket* events, Batch& batch);
+
+  void Commit(uint32_t channeluid, uint32_t start, uint32_t end, Batch& batch);
+
+  void Release(Batch& batch);
+
+  /**
+   * Pass the events overlapping [start, end) to the client.
+   */
+  void Transfer(ClientInterface* client, uint32_t channeluid, uint32_t start, uint32_t end);
+
+private:
+
+  struct Fetched {
+    uint32_t end;
+    uint32_t time;
+  };
+
+  typedef std::map<uint32_t, Event> Events;
+
+  struct ChannelEpg {
+    ChannelEpg() : loaded(false) {}
+
+    Events events;
+    std::map<uint32_t, uint32_t> broadcasts;
+    std::map<uint32_t, Fetched> ranges;
+    bool loaded;
+  };
+
+  typedef std::map<uint32_t, ChannelEpg> Channels;
+
+  ChannelEpg& GetChannel(uint32_t channeluid);
+
+  std::string GetFilename(uint32_t channeluid);
+
+  void Load(uint32_t channeluid, ChannelEpg& c);
+
+  void Save(uint32_t channeluid, ChannelEpg& c);
+
+  void Expire(ChannelEpg& c);
+
+  Events::iterator First(ChannelEpg& c, uint32_t start);
+
+  // read an event of a XVDR_EPG_GETFORCHANNEL response, the strings are interned
+  uint32_t Read(MsgPacket* p, Event& e);
+
+  static void Write(MsgPacket& p, Events::const_iterator i);
+
+  void Insert(ChannelEpg& c, uint32_t start, const Event& e);
+
+  void Replace(ChannelEpg& c, uint32_t start, const Event& e);
+
+  void Remove(ChannelEpg& c, Events::iterator i);
+
+  void Release(const Event& e);
+
+  static void Unpack(uint32_t channeluid, Events::const_iterator i, EpgItemRef& item);
+
+  void AddRange(ChannelEpg& c, uint32_t start, uint32_t end, uint32_t time);
+
+  Channels m_channels;
+  std::string m_folder;
+  uint32_t m_maxage;
+  StringPool m_strings;
+  Mutex m_lock;
+};
+
+} // namespace XVDR
@@ -0,0 +1,223 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "xvdr/frameparser.h"
+
+using namespace XVDR;
+
+namespace {
+
+// minimal bit reader for slice header fields
+class BitReader {
+public:
+
+  BitReader(const uint8_t* data, const uint8_t* end) : m_data(data), m_end(end), m_bit(0) {}
+
+  int GetBit() {
+    if(m_data >= m_end) {
+      return 0;
+    }
+
+    int bit = (*m_data >> (7 - m_bit)) & 1;
+
+    if(++m_bit == 8) {
+      m_bit = 0;
+      m_data++;
+    }
+
+    return bit;
+  }
+
+  // unsigned exp-golomb code
+  uint32_t GetUE() {
+    int zeros = 0;
+
+    while(GetBit() == 0) {
+      if(++zeros > 31 || m_data >= m_end) {
+        return 0;
+      }
+    }
+
+    uint32_t value = 0;
+
+    for(int i = 0; i < zeros; i++) {
+      value = (value << 1) | GetBit();
+    }
+
+    return (1 << zeros) - 1 + value;
+  }
+
+private:
+
+  const uint8_t* m_data;
+  const uint8_t* m_end;
+  int m_bit;
+};
+
+} // namespace
+
+FrameParser::Codec FrameParser::GetCodec(const std::string& type) {
+  if(type == "MPEG2VIDEO") {
+    return CODEC_MPEG2;
+  }
+  else if(type == "H264") {
+    return CODEC_H264;
+  }
+  else if(type == "H265" || type == "HEVC") {
+    return CODEC_HEVC;
+  }
+
+  return CODEC_UNKNOWN;
+}
+
+const uint8_t* FrameParser::FindStartCodeScalar(const uint8_t* p, const uint8_t* end) {
+  for(; p + 3 <= end; p++) {
+    // skip ahead if the third byte can't be part of a prefix
+    if(p[2] > 1) {
+      p += 2;
+    }
+    else if(p[0] == 0 && p[1] == 0 && p[2] == 1) {
+      return p + 3;
+    }
+  }
+
+  return NULL;
+}
+
+const uint8_t* FrameParser::FindStartCode(const uint8_t* p, const uint8_t* end) {
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+
+  // compare 16 candidate positions at once
+  while(end - p >= 18) {
+    __m128i b0 = _mm_loadu_si128((const __m128i*)p);
+    __m128i b1 = _mm_loadu_si128((const __m128i*)(p + 1));
+    __m128i b2 = _mm_loadu_si128((const __m128i*)(p + 2));
+
+    __m128i m = _mm_and_si128(
+                  _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+                  _mm_cmpeq_epi8(b2, one));
+
+    int mask = _mm_movemask_epi8(m);
+
+    if(mask != 0) {
+      return p + __builtin_ctz(mask) + 3;
+    }
+
+    p += 16;
+  }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+  const uint8x16_t zero = vdupq_n_u8(0);
+  const uint8x16_t one = vdupq_n_u8(1);
+
+  while(end - p >= 18) {
+    uint8x16_t b0 = vld1q_u8(p);
+    uint8x16_t b1 = vld1q_u8(p + 1);
+    uint8x16_t b2 = vld1q_u8(p + 2);
+
+    uint8x16_t m = vandq_u8(vandq_u8(vceqq_u8(b0, zero), vceqq_u8(b1, zero)), vceqq_u8(b2, one));
+    uint64x2_t m64 = vreinterpretq_u64_u8(m);
+
+    if((vgetq_lane_u64(m64, 0) | vgetq_lane_u64(m64, 1)) != 0) {
+      return FindStartCodeScalar(p, p + 18);
+    }
+
+    p += 16;
+  }
+#endif
+
+  return FindStartCodeScalar(p, end);
+}
+
+FrameParser::FrameType FrameParser::GetFrameType(Codec codec, const uint8_t* data, int length) {
+  const uint8_t* end = data + length;
+  const uint8_t* p = data;
+
+  while((p = FindStartCode(p, end)) != NULL && p < end) {
+    switch(codec) {
+      case CODEC_MPEG2:
+        // picture start code, picture_coding_type follows the temporal reference
+        if(p[0] == 0x00 && end - p >= 3) {
+          int type = (p[2] >> 3) & 0x07;
+          if(type >= FT_IFRAME && type <= FT_BFRAME) {
+            return (FrameType)type;
+          }
+        }
+        break;
+
+      case CODEC_H264: {
+        int nal = p[0] & 0x1F;
+
+        // IDR slice
+        if(nal == 5) {
+          return FT_IFRAME;
+        }
+
+        // non-IDR slice
+        if(nal == 1) {
+          BitReader bits(p + 1, end);
+          bits.GetUE(); // first_mb_in_slice
+
+          switch(bits.GetUE() % 5) {
+            case 2:
+            case 4:
+              return FT_IFRAME;
+            case 1:
+              return FT_BFRAME;
+            default:
+              return FT_PFRAME;
+          }
+        }
+        break;
+      }
+
+      case CODEC_HEVC: {
+        int nal = (p[0] >> 1) & 0x3F;
+
+        // IRAP pictures (BLA, IDR, CRA)
+        if(nal >= 16 && nal <= 21) {
+          return FT_IFRAME;
+        }
+
+        // slice types of other pictures need the PPS, treat them as non-seekable
+        if(nal <= 9) {
+          return FT_PFRAME;
+        }
+        break;
+      }
+
+      default:
+        return FT_UNKNOWN;
+    }
+  }
+
+  return FT_UNKNOWN;
+}
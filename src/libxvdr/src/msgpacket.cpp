@@ -319,6 +319,10 @@ uint32_t MsgPacket::getPayloadLength() {
 	return m_usage - HeaderLength;
 }
 
+uint32_t MsgPacket::getHeaderPayloadLength() {
+	return be32toh(readPacket<uint32_t>(PayloadLengthPos));
+}
+
 uint32_t MsgPacket::getUID() {
 	return be32toh(readPacket<uint32_t>(UIDPos));
 }
@@ -404,8 +408,8 @@ bool MsgPacket::checkPacketSize(uint32_t bytes) {
 	return true;
 }
 
-uint32_t MsgPacket::crc32(const uint8_t* buf, int size) {
-	uint32_t crc = 0xFFFFFFFF;
+uint32_t MsgPacket::crc32(const uint8_t* buf, int size, uint32_t crc) {
+	crc = ~crc;
 	const uint8_t* p = buf;
 
 	while(size--) {
@@ -451,6 +455,21 @@ MsgPacket* MsgPacket::read(int fd, int timeout_ms) {
 }
 
 MsgPacket* MsgPacket::read(int fd, bool& closed, int timeout_ms) {
+	MsgPacket* p = readheader(fd, closed, timeout_ms);
+
+	if(p == NULL) {
+		return NULL;
+	}
+
+	if(!p->readpayload(fd, timeout_ms)) {
+		delete p;
+		return NULL;
+	}
+
+	return p;
+}
+
+MsgPacket* MsgPacket::readheader(int fd, bool& closed, int timeout_ms) {
 	if(pollfd(fd, timeout_ms, true) <= 0) {
 		return NULL;
 	}
@@ -496,7 +515,6 @@ MsgPacket* MsgPacket::read(int fd, bool& closed, int timeout_ms) {
 
 	// header validation
 	uint32_t checksum = p->getCheckSum();
-	datalen = be32toh(p->readPacket<uint32_t>(PayloadLengthPos));
 	uint32_t test = crc32(header, CheckSumPos);
 
 	if(checksum != test) {
@@ -507,35 +525,47 @@ MsgPacket* MsgPacket::read(int fd, bool& closed, int timeout_ms) {
 		return NULL;
 	}
 
+	return p;
+}
+
+bool MsgPacket::readpayload(int fd, int timeout_ms) {
+	uint32_t datalen = be32toh(readPacket<uint32_t>(PayloadLengthPos));
+
 	// no payload ?
 	if(datalen == 0) {
-		return p;
+		return true;
 	}
 
 	// read payload
-	data = p->reserve(datalen);
+	uint8_t* data = reserve(datalen);
 
 	if(data == NULL) {
-		delete p;
-		return NULL;
+		return false;
 	}
 
 	if(socketread(fd, data, datalen, timeout_ms) != 0) {
-		delete p;
-		return NULL;
+		return false;
 	}
 
-	// payload checksum validation
-	uint32_t plcs = p->getPayloadCheckSum();
-	p->m_payloadchecksum = (plcs != 0);
+	// payload checksum validation (in place)
+	uint32_t plcs = getPayloadCheckSum();
+	m_payloadchecksum = (plcs != 0);
 
-	if(p->m_payloadchecksum && p->getPayloadCheckSum() != crc32(data, datalen)) {
+	if(m_payloadchecksum && plcs != crc32(data, datalen)) {
 		std::cerr << "wrong payload checksum !" << std::endl;
-		delete p;
-		return NULL;
+		return false;
 	}
 
-	return p;
+	return true;
+}
+
+void MsgPacket::reuse(MsgPacket* header) {
+	memcpy(m_packet, header->m_packet, HeaderLength);
+
+	m_usage = HeaderLength;
+	m_readposition = HeaderLength;
+	m_freezed = false;
+	m_payloadchecksum = true;
 }
 
 bool MsgPacket::readstream(std::istream& in, MsgPacket& p) {
@@ -26,6 +26,12 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef WIN32
+#include <direct.h>
+#endif
 
 // WINDOWS
 
@@ -199,3 +205,13 @@ const char* os_gettempfolder() {
 
   return temp;
 }
+
+bool os_mkdir(const char* path) {
+#if defined(WIN32)
+  int rc = _mkdir(path);
+#else
+  int rc = mkdir(path, 0755);
+#endif
+
+  return (rc == 0 || errno == EEXIST);
+}
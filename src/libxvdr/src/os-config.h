@@ -115,3 +115,4 @@ bool setsock_nonblock(int fd, bool nonblock = true);
 void setsock_keepalive(int fd);
 int socketread(int fd, uint8_t* data, int datalen, int timeout_ms);
 const char* os_gettempfolder();
+bool os_mkdir(const char* path);
@@ -198,7 +198,7 @@ public:
     if(_packet == NULL) {
       return 0;
     }
-    return _packet->getClientID() && 0xFF;
+    return _packet->getClientID() & 0xFF;
   }
 
   int64_t pts() {
@@ -0,0 +1,281 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "xvdr/msgpacket.h"
+#include "recordingcache.h"
+
+// the spill file is binary and may grow beyond 2 GB
+#ifdef WIN32
+#include <io.h>
+#define SPILL_OPENFLAGS (O_CREAT | O_TRUNC | O_RDWR | O_BINARY)
+#define spill_seek(fd, offset) _lseeki64(fd, (__int64)(offset), SEEK_SET)
+#else
+#define SPILL_OPENFLAGS (O_CREAT | O_TRUNC | O_RDWR)
+#define spill_seek(fd, offset) lseek(fd, (off_t)(offset), SEEK_SET)
+#endif
+
+using namespace XVDR;
+
+RecordingCache::RecordingCache(size_t max_size, uint32_t blocksize) :
+  m_size(0),
+  m_max_size(max_size),
+  m_fd(-1),
+  m_blocksize(blocksize) {
+}
+
+RecordingCache::~RecordingCache() {
+  SetSpillFile("", 0);
+  Clear();
+
+  for(std::vector<MsgPacket*>::iterator i = m_pool.begin(); i != m_pool.end(); i++) {
+    delete *i;
+  }
+}
+
+void RecordingCache::SetMaxSize(size_t max_size) {
+  m_max_size = max_size;
+  Evict();
+}
+
+bool RecordingCache::SetSpillFile(const std::string& file, size_t max_size) {
+  while(!m_diskblocks.empty()) {
+    RemoveDiskBlock(m_diskblocks.begin());
+  }
+
+  m_freeslots.clear();
+
+  if(m_fd != -1) {
+    close(m_fd);
+    unlink(m_spillfile.c_str());
+    m_fd = -1;
+  }
+
+  m_spillfile = file;
+
+  if(m_spillfile.empty() || max_size < m_blocksize) {
+    return true;
+  }
+
+  m_fd = open(m_spillfile.c_str(), SPILL_OPENFLAGS, 0644);
+
+  if(m_fd == -1) {
+    return false;
+  }
+
+  for(uint32_t slot = (uint32_t)(max_size / m_blocksize); slot > 0; slot--) {
+    m_freeslots.push_back(slot - 1);
+  }
+
+  return true;
+}
+
+void RecordingCache::Put(uint64_t position, MsgPacket* block) {
+  DiskBlocks::iterator d = m_diskblocks.find(position);
+
+  if(d != m_diskblocks.end()) {
+    RemoveDiskBlock(d);
+  }
+
+  MemoryBlocks::iterator i = m_blocks.find(position);
+
+  if(i != m_blocks.end()) {
+    m_size -= i->second.packet->getPayloadLength();
+    Release(i->second.packet);
+    m_lru.erase(i->second.lru);
+    m_blocks.erase(i);
+  }
+
+  m_lru.push_front(position);
+
+  MemoryBlock& b = m_blocks[position];
+  b.packet = block;
+  b.lru = m_lru.begin();
+
+  m_size += block->getPayloadLength();
+  Evict();
+}
+
+uint32_t RecordingCache::Read(uint64_t position, uint8_t* buf, uint32_t size) {
+  uint32_t copied = 0;
+  bool complete = true;
+
+  while(copied < size && complete) {
+    uint64_t start = BlockStart(position);
+    uint32_t count = ReadBlock(start, (uint32_t)(position - start), buf + copied, size - copied, complete);
+
+    if(count == 0) {
+      break;
+    }
+
+    copied += count;
+    position += count;
+  }
+
+  return copied;
+}
+
+uint32_t RecordingCache::ReadBlock(uint64_t start, uint32_t offset, uint8_t* buf, uint32_t size, bool& complete) {
+  uint32_t length = 0;
+  uint32_t count = 0;
+
+  MemoryBlocks::iterator i = m_blocks.find(start);
+
+  if(i != m_blocks.end()) {
+    MsgPacket* block = i->second.packet;
+    length = block->getPayloadLength();
+
+    if(offset >= length) {
+      return 0;
+    }
+
+    count = (length - offset < size) ? length - offset : size;
+    memcpy(buf, block->getPayload() + offset, count);
+
+    m_lru.splice(m_lru.begin(), m_lru, i->second.lru);
+  }
+  else {
+    DiskBlocks::iterator d = m_diskblocks.find(start);
+
+    if(d == m_diskblocks.end()) {
+      return 0;
+    }
+
+    length = d->second.length;
+
+    if(offset >= length) {
+      return 0;
+    }
+
+    count = (length - offset < size) ? length - offset : size;
+
+    if(spill_seek(m_fd, (uint64_t)d->second.slot * m_blocksize + offset) == -1 || read(m_fd, buf, count) != (ssize_t)count) {
+      RemoveDiskBlock(d);
+      return 0;
+    }
+
+    m_disklru.splice(m_disklru.begin(), m_disklru, d->second.lru);
+  }
+
+  // short block (end of recording)
+  complete = (length == m_blocksize);
+
+  return count;
+}
+
+bool RecordingCache::Contains(uint64_t position) {
+  uint64_t start = BlockStart(position);
+  return (m_blocks.find(start) != m_blocks.end() || m_diskblocks.find(start) != m_diskblocks.end());
+}
+
+void RecordingCache::Clear() {
+  for(MemoryBlocks::iterator i = m_blocks.begin(); i != m_blocks.end(); i++) {
+    Release(i->second.packet);
+  }
+
+  m_blocks.clear();
+  m_lru.clear();
+  m_size = 0;
+
+  while(!m_diskblocks.empty()) {
+    RemoveDiskBlock(m_diskblocks.begin());
+  }
+}
+
+void RecordingCache::Evict() {
+  while(m_size > m_max_size && !m_lru.empty()) {
+    uint64_t position = m_lru.back();
+    MemoryBlocks::iterator i = m_blocks.find(position);
+
+    m_lru.pop_back();
+    m_size -= i->second.packet->getPayloadLength();
+
+    Spill(position, i->second.packet);
+    Release(i->second.packet);
+
+    m_blocks.erase(i);
+  }
+}
+
+void RecordingCache::Spill(uint64_t position, MsgPacket* block) {
+  if(m_fd == -1) {
+    return;
+  }
+
+  // reuse the least recently used slot if the file is full
+  if(m_freeslots.empty() && !m_disklru.empty()) {
+    RemoveDiskBlock(m_diskblocks.find(m_disklru.back()));
+  }
+
+  if(m_freeslots.empty()) {
+    return;
+  }
+
+  uint32_t slot = m_freeslots.back();
+  uint32_t length = block->getPayloadLength();
+
+  if(spill_seek(m_fd, (uint64_t)slot * m_blocksize) == -1 || write(m_fd, block->getPayload(), length) != (ssize_t)length) {
+    return;
+  }
+
+  m_freeslots.pop_back();
+  m_disklru.push_front(position);
+
+  DiskBlock& d = m_diskblocks[position];
+  d.slot = slot;
+  d.length = length;
+  d.lru = m_disklru.begin();
+}
+
+void RecordingCache::RemoveDiskBlock(DiskBlocks::iterator i) {
+  m_freeslots.push_back(i->second.slot);
+  m_disklru.erase(i->second.lru);
+  m_diskblocks.erase(i);
+}
+
+MsgPacket* RecordingCache::Recycle() {
+  if(m_pool.empty()) {
+    return NULL;
+  }
+
+  MsgPacket* block = m_pool.back();
+  m_pool.pop_back();
+
+  return block;
+}
+
+void RecordingCache::Release(MsgPacket* block) {
+  // keep a few full sized blocks around for receiving
+  if(m_pool.size() < 16 && block->getPayloadLength() == m_blocksize) {
+    m_pool.push_back(block);
+    return;
+  }
+
+  delete block;
+}
@@ -0,0 +1,151 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+class MsgPacket;
+
+namespace XVDR {
+
+/**
+ * Block cache for recorded streams.
+ *
+ * Holds the GETBLOCK responses of a recording, keyed by the block aligned
+ * position they were requested at. The payload stays in the response
+ * packet, so storing a block doesn't copy any data.
+ *
+ * The cache is bounded, the least recently used blocks get dropped or
+ * moved to a spill file on disk if one is configured.
+ */
+class RecordingCache {
+public:
+
+  RecordingCache(size_t max_size = 16 * 1024 * 1024, uint32_t blocksize = 64 * 1024);
+  ~RecordingCache();
+
+  /**
+   * Set the maximum size of the in-memory cache in bytes.
+   */
+  void SetMaxSize(size_t max_size);
+
+  /**
+   * Spill blocks dropped from memory to a file.
+   *
+   * @param file      Path to the spill file. If empty the spill file is disabled.
+   * @param max_size  Maximum size of the spill file in bytes.
+   */
+  bool SetSpillFile(const std::string& file, size_t max_size);
+
+  /**
+   * Size of a cache block in bytes.
+   */
+  uint32_t BlockSize() {
+    return m_blocksize;
+  }
+
+  /**
+   * Returns the start of the block containing the position.
+   */
+  uint64_t BlockStart(uint64_t position) {
+    return position - (position % m_blocksize);
+  }
+
+  /**
+   * Store the response for the block at position (takes ownership).
+   */
+  void Put(uint64_t position, MsgPacket* block);
+
+  /**
+   * Copy cached data at position into buf.
+   *
+   * @return number of bytes copied, 0 if the position isn't cached.
+   */
+  uint32_t Read(uint64_t position, uint8_t* buf, uint32_t size);
+
+  /**
+   * Check if the block at position is cached.
+   */
+  bool Contains(uint64_t position);
+
+  /**
+   * Drop all blocks.
+   */
+  void Clear();
+
+  /**
+   * Returns the packet of a dropped block for receiving into it or NULL.
+   */
+  MsgPacket* Recycle();
+
+private:
+
+  typedef std::list<uint64_t> Lru;
+
+  struct MemoryBlock {
+    MsgPacket* packet;
+    Lru::iterator lru;
+  };
+
+  struct DiskBlock {
+    uint32_t slot;
+    uint32_t length;
+    Lru::iterator lru;
+  };
+
+  typedef std::map<uint64_t, MemoryBlock> MemoryBlocks;
+  typedef std::map<uint64_t, DiskBlock> DiskBlocks;
+
+  uint32_t ReadBlock(uint64_t start, uint32_t offset, uint8_t* buf, uint32_t size, bool& complete);
+
+  void Evict();
+
+  void Spill(uint64_t position, MsgPacket* block);
+
+  void RemoveDiskBlock(DiskBlocks::iterator i);
+
+  void Release(MsgPacket* block);
+
+  MemoryBlocks m_blocks;
+  Lru m_lru;
+  size_t m_size;
+  size_t m_max_size;
+
+  DiskBlocks m_diskblocks;
+  Lru m_disklru;
+  std::vector<uint32_t> m_freeslots;
+  std::string m_spillfile;
+  int m_fd;
+
+  std::vector<MsgPacket*> m_pool;
+
+  uint32_t m_blocksize;
+};
+
+} // namespace XVDR
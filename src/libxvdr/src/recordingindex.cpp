@@ -0,0 +1,348 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <fstream>
+
+#include "xvdr/msgpacket.h"
+#include "xvdr/command.h"
+#include "xvdr/clientinterface.h"
+#include "recordingindex.h"
+
+using namespace XVDR;
+
+// bump if the layout of the stored entries changes
+#define RECORDINGINDEX_VERSION 1
+
+RecordingIndex::RecordingIndex() : m_valid(false) {
+}
+
+bool RecordingIndex::Load(const std::string& filename) {
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+
+  if(!in.is_open()) {
+    return false;
+  }
+
+  MsgPacket p;
+
+  if(!MsgPacket::readstream(in, p) || p.getMsgID() != XVDR_RECORDINGS_GETLIST || p.get_U32() != RECORDINGINDEX_VERSION) {
+    return false;
+  }
+
+  Entries entries;
+  Read(&p, entries);
+
+  MutexLock lock(&m_lock);
+
+  for(Index::iterator i = m_entries.begin(); i != m_entries.end(); i++) {
+    Release(i->second);
+  }
+
+  m_entries.swap(entries);
+  m_valid = true;
+  return true;
+}
+
+bool RecordingIndex::Save(const std::string& filename) {
+  MsgPacket p(XVDR_RECORDINGS_GETLIST);
+  p.put_U32(RECORDINGINDEX_VERSION);
+
+  {
+    MutexLock lock(&m_lock);
+
+    for(Index::iterator i = m_entries.begin(); i != m_entries.end(); i++) {
+      Write(p, i);
+    }
+  }
+
+  std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+  if(!out.is_open()) {
+    return false;
+  }
+
+  p.freeze();
+  out << p;
+
+  return out.good();
+}
+
+int RecordingIndex::Update(MsgPacket* list, std::vector<std::string>* changed) {
+  Entries entries;
+  Read(list, entries);
+
+  return Update(entries, changed);
+}
+
+void RecordingIndex::Read(MsgPacket* list, Entries& entries) {
+  MutexLock lock(&m_lock);
+
+  while(!list->eop()) {
+    Entry e;
+    std::string id = Read(list, e);
+
+    // a duplicate id replaces the entry
+    Index::iterator i = entries.find(id);
+
+    if(i != entries.end()) {
+      Release(i->second);
+      i->second = e;
+    }
+    else {
+      entries[id] = e;
+    }
+  }
+}
+
+void RecordingIndex::Release(Entries& entries) {
+  MutexLock lock(&m_lock);
+
+  for(Entries::iterator i = entries.begin(); i != entries.end(); i++) {
+    Release(i->second);
+  }
+
+  entries.clear();
+}
+
+int RecordingIndex::Update(Entries& entries, std::vector<std::string>* changed) {
+  int changes = 0;
+
+  MutexLock lock(&m_lock);
+
+  // the new entries share the strings with the old ones
+  Index index;
+  index.swap(entries);
+
+  // both maps are sorted by id, walk them side by side
+  Index::iterator o = m_entries.begin();
+  Index::iterator n = index.begin();
+
+  while(o != m_entries.end() || n != index.end()) {
+    Index::iterator i;
+
+    if(n == index.end() || (o != m_entries.end() && o->first < n->first)) {
+      i = o++;
+    }
+    else if(o == m_entries.end() || n->first < o->first) {
+      i = n++;
+    }
+    else {
+      bool equal = Equal(o->second, n->second);
+      i = o++;
+      n++;
+
+      if(equal) {
+        continue;
+      }
+    }
+
+    if(changed != NULL) {
+      changed->push_back(i->first);
+    }
+
+    changes++;
+  }
+
+  // an empty list is news if we didn't know it before
+  if(!m_valid) {
+    changes++;
+  }
+
+  for(Index::iterator i = m_entries.begin(); i != m_entries.end(); i++) {
+    Release(i->second);
+  }
+
+  m_entries.swap(index);
+  m_valid = true;
+
+  return changes;
+}
+
+bool RecordingIndex::Valid() {
+  MutexLock lock(&m_lock);
+  return m_valid;
+}
+
+void RecordingIndex::Invalidate() {
+  MutexLock lock(&m_lock);
+  m_valid = false;
+}
+
+int RecordingIndex::Count() {
+  MutexLock lock(&m_lock);
+  return (int)m_entries.size();
+}
+
+void RecordingIndex::GetIds(std::vector<std::string>& ids) {
+  MutexLock lock(&m_lock);
+
+  ids.reserve(m_entries.size());
+
+  for(Index::iterator i = m_entries.begin(); i != m_entries.end(); i++) {
+    ids.push_back(i->first);
+  }
+}
+
+std::string RecordingIndex::GetName(const std::string& id) {
+  MutexLock lock(&m_lock);
+
+  Index::iterator i = m_entries.find(id);
+
+  if(i == m_entries.end()) {
+    return "";
+  }
+
+  std::string name = i->second.directory;
+
+  // folders are separated by '~' in VDR
+  for(std::string::iterator c = name.begin(); c != name.end(); c++) {
+    if(*c == '/') {
+      *c = '~';
+    }
+  }
+
+  while(!name.empty() && name[0] == '~') {
+    name.erase(0, 1);
+  }
+
+  while(!name.empty() && name[name.size() - 1] == '~') {
+    name.erase(name.size() - 1);
+  }
+
+  if(!name.empty()) {
+    name += '~';
+  }
+
+  return name + i->second.title;
+}
+
+void RecordingIndex::SetPlayCount(const std::string& id, int count) {
+  MutexLock lock(&m_lock);
+
+  Index::iterator i = m_entries.find(id);
+
+  if(i != m_entries.end()) {
+    i->second.playcount = count;
+  }
+}
+
+void RecordingIndex::Transfer(ClientInterface* client) {
+  MutexLock lock(&m_lock);
+  std::vector<RecordingEntryRef> recs;
+  recs.reserve(m_entries.size());
+
+  for(Index::iterator i = m_entries.begin(); i != m_entries.end(); i++) {
+    recs.push_back(RecordingEntryRef());
+    Unpack(i, recs.back());
+  }
+
+  // the strings are passed straight from the pool, it's locked meanwhile
+  client->TransferRecordingEntries(recs);
+}
+
+std::string RecordingIndex::Read(MsgPacket* p, Entry& e) {
+  e.time = p->get_U32();
+  e.duration = p->get_U32();
+  e.priority = p->get_U32();
+  e.lifetime = p->get_U32();
+  e.channelname = m_strings.Intern(p->get_String());
+  e.title = m_strings.Intern(p->get_String());
+  e.plotoutline = m_strings.Intern(p->get_String());
+  e.plot = m_strings.Intern(p->get_String());
+  e.directory = m_strings.Intern(p->get_String());
+  std::string id = p->get_String();
+  e.playcount = p->get_U32();
+
+  uint32_t content = p->get_U32();
+  e.genretype = content & 0xF0;
+  e.genresubtype = content & 0x0F;
+
+  e.thumbnailpath = m_strings.Intern(p->get_String());
+  e.iconpath = m_strings.Intern(p->get_String());
+
+  return id;
+}
+
+void RecordingIndex::Write(MsgPacket& p, Index::const_iterator i) {
+  p.put_U32(i->second.time);
+  p.put_U32(i->second.duration);
+  p.put_U32(i->second.priority);
+  p.put_U32(i->second.lifetime);
+  p.put_String(i->second.channelname);
+  p.put_String(i->second.title);
+  p.put_String(i->second.plotoutline);
+  p.put_String(i->second.plot);
+  p.put_String(i->second.directory);
+  p.put_String(i->first.c_str());
+  p.put_U32(i->second.playcount);
+  p.put_U32(i->second.genretype | i->second.genresubtype);
+  p.put_String(i->second.thumbnailpath);
+  p.put_String(i->second.iconpath);
+}
+
+void RecordingIndex::Release(Entry& e) {
+  m_strings.Release(e.channelname);
+  m_strings.Release(e.title);
+  m_strings.Release(e.plotoutline);
+  m_strings.Release(e.plot);
+  m_strings.Release(e.directory);
+  m_strings.Release(e.thumbnailpath);
+  m_strings.Release(e.iconpath);
+}
+
+void RecordingIndex::Unpack(Index::const_iterator i, RecordingEntryRef& rec) {
+  rec.Id = i->first.c_str();
+  rec.Time = i->second.time;
+  rec.Duration = i->second.duration;
+  rec.Priority = i->second.priority;
+  rec.LifeTime = i->second.lifetime;
+  rec.GenreType = i->second.genretype;
+  rec.GenreSubType = i->second.genresubtype;
+  rec.PlayCount = i->second.playcount;
+  rec.ChannelName = i->second.channelname;
+  rec.Title = i->second.title;
+  rec.PlotOutline = i->second.plotoutline;
+  rec.Plot = i->second.plot;
+  rec.Directory = i->second.directory;
+  rec.ThumbNailPath = i->second.thumbnailpath;
+  rec.IconPath = i->second.iconpath;
+}
+
+bool RecordingIndex::Equal(const Entry& a, const Entry& b) {
+  return
+    a.time == b.time &&
+    a.duration == b.duration &&
+    a.priority == b.priority &&
+    a.lifetime == b.lifetime &&
+    a.playcount == b.playcount &&
+    a.genretype == b.genretype &&
+    a.genresubtype == b.genresubtype &&
+    a.channelname == b.channelname &&
+    a.title == b.title &&
+    a.plotoutline == b.plotoutline &&
+    a.plot == b.plot &&
+    a.directory == b.directory &&
+    a.thumbnailpath == b.thumbnailpath &&
+    a.iconpath == b.iconpath;
+}
@@ -0,0 +1,165 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "xvdr/dataset.h"
+#include "xvdr/thread.h"
+
+#include "stringpool.h"
+
+class MsgPacket;
+
+namespace XVDR {
+
+class ClientInterface;
+
+/**
+ * Local copy of the recordings list.
+ *
+ * Entries are keyed by the recording id. A fresh list from the server is
+ * merged into the index, so the caller learns if anything changed at all.
+ * The index can be stored on disk to be available right after startup.
+ * Channel names, folders and series titles are kept in a string pool.
+ */
+class RecordingIndex {
+public:
+
+  // an entry without the id, the strings are in the pool of the index
+  struct Entry {
+    uint32_t time;
+    uint32_t duration;
+    uint8_t priority;
+    uint8_t lifetime;
+    uint8_t genretype;
+    uint8_t genresubtype;
+    uint8_t playcount;
+    const char* channelname;
+    const char* title;
+    const char* plotoutline;
+    const char* plot;
+    const char* directory;
+    const char* thumbnailpath;
+    const char* iconpath;
+  };
+
+  typedef std::map<std::string, Entry> Entries;
+
+  RecordingIndex();
+
+  /**
+   * Load the index from a file written by Save().
+   */
+  bool Load(const std::string& filename);
+
+  /**
+   * Write the index to a file.
+   */
+  bool Save(const std::string& filename);
+
+  /**
+   * Replace the index by the entries of a XVDR_RECORDINGS_GETLIST response.
+   *
+   * @param list     the response
+   * @param changed  receives the ids of added, changed and removed entries
+   * @return number of added, changed and removed entries
+   */
+  int Update(MsgPacket* list, std::vector<std::string>* changed = NULL);
+
+  /**
+   * Decode the entries of a XVDR_RECORDINGS_GETLIST response (or a part of it).
+   */
+  void Read(MsgPacket* list, Entries& entries);
+
+  /**
+   * Drop entries decoded with Read() instead of updating the index.
+   */
+  void Release(Entries& entries);
+
+  /**
+   * Replace the index by entries decoded with Read().
+   */
+  int Update(Entries& entries, std::vector<std::string>* changed = NULL);
+
+  /**
+   * Check if the index holds a list (loaded or updated).
+   */
+  bool Valid();
+
+  /**
+   * Mark the index as outdated.
+   */
+  void Invalidate();
+
+  /**
+   * Number of recordings in the index.
+   */
+  int Count();
+
+  /**
+   * Get the ids of all recordings.
+   */
+  void GetIds(std::vector<std::string>& ids);
+
+  /**
+   * Get the name VDR uses for a recording ("folder~title"), empty if unknown.
+   */
+  std::string GetName(const std::string& id);
+
+  /**
+   * Update the play count of a single recording.
+   */
+  void SetPlayCount(const std::string& id, int count);
+
+  /**
+   * Pass all entries to the client.
+   */
+  void Transfer(ClientInterface* client);
+
+private:
+
+  typedef Entries Index;
+
+  // read an entry in the layout of RecordingEntry, returns the id
+  std::string Read(MsgPacket* p, Entry& e);
+
+  static void Write(MsgPacket& p, Index::const_iterator i);
+
+  void Release(Entry& e);
+
+  static void Unpack(Index::const_iterator i, RecordingEntryRef& rec);
+
+  // the strings of both are interned, so equal strings have equal pointers
+  static bool Equal(const Entry& a, const Entry& b);
+
+  Index m_entries;
+  StringPool m_strings;
+  bool m_valid;
+  Mutex m_lock;
+};
+
+} // namespace XVDR
@@ -0,0 +1,179 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "xvdr/command.h"
+#include "xvdr/msgpacket.h"
+
+#include "recordingstripe.h"
+
+using namespace XVDR;
+
+RecordingStripe::RecordingStripe(int timeout_ms) : m_length(0) {
+  m_timeout = timeout_ms;
+}
+
+RecordingStripe::~RecordingStripe() {
+  Close();
+
+  for(std::map<uint32_t, MsgPacket*>::iterator i = m_buffers.begin(); i != m_buffers.end(); i++) {
+    delete i->second;
+  }
+
+  for(std::map<uint32_t, MsgPacket*>::iterator i = m_received.begin(); i != m_received.end(); i++) {
+    delete i->second;
+  }
+}
+
+bool RecordingStripe::OpenRecording(const std::string& hostname, const std::string& name, const std::string& recid) {
+  if(!Open(hostname)) {
+    return false;
+  }
+
+  // blocks are sent uncompressed, there is no stream to set up
+  MsgPacket login(XVDR_LOGIN);
+  login.setProtocolVersion(XVDRPROTOCOLVERSION);
+  login.put_U8(0);
+  login.put_String(name.c_str());
+  login.put_String("");
+  login.put_U8(0);
+
+  MsgPacket* vresp = ReadResult(&login);
+
+  if(vresp == NULL) {
+    return false;
+  }
+
+  delete vresp;
+
+  MsgPacket open(XVDR_RECSTREAM_OPEN);
+  open.put_String(recid.c_str());
+
+  vresp = ReadResult(&open);
+  bool rc = (vresp != NULL && vresp->get_U32() == XVDR_RET_OK);
+
+  // frames, bytes
+  if(rc) {
+    vresp->get_U32();
+    m_length = vresp->get_U64();
+  }
+
+  delete vresp;
+  return rc;
+}
+
+bool RecordingStripe::Send(MsgPacket* request, MsgPacket* buffer) {
+  if(ConnectionLost() || !TransmitMessage(request)) {
+    delete buffer;
+    return false;
+  }
+
+  if(buffer != NULL) {
+    m_buffers[request->getUID()] = buffer;
+  }
+
+  return true;
+}
+
+MsgPacket* RecordingStripe::Receive(MsgPacket* request) {
+  uint32_t uid = request->getUID();
+
+  for(;;) {
+    std::map<uint32_t, MsgPacket*>::iterator i = m_received.find(uid);
+
+    if(i != m_received.end()) {
+      MsgPacket* p = i->second;
+      m_received.erase(i);
+      return p;
+    }
+
+    MsgPacket* p = ReadMessage();
+
+    if(p == NULL) {
+      return NULL;
+    }
+
+    if(m_cancelled.erase(p->getUID()) > 0) {
+      delete p;
+      continue;
+    }
+
+    if(p->getUID() == uid) {
+      return p;
+    }
+
+    m_received[p->getUID()] = p;
+  }
+}
+
+void RecordingStripe::Cancel(MsgPacket* request) {
+  uint32_t uid = request->getUID();
+
+  std::map<uint32_t, MsgPacket*>::iterator b = m_buffers.find(uid);
+
+  if(b != m_buffers.end()) {
+    delete b->second;
+    m_buffers.erase(b);
+  }
+
+  std::map<uint32_t, MsgPacket*>::iterator r = m_received.find(uid);
+
+  if(r != m_received.end()) {
+    delete r->second;
+    m_received.erase(r);
+    return;
+  }
+
+  // skip the response when it arrives
+  m_cancelled.insert(uid);
+}
+
+bool RecordingStripe::Update() {
+  MsgPacket update(XVDR_RECSTREAM_UPDATE);
+
+  if(!Send(&update)) {
+    return false;
+  }
+
+  MsgPacket* vresp = Receive(&update);
+  delete vresp;
+
+  return (vresp != NULL);
+}
+
+MsgPacket* RecordingStripe::ReceiveBuffer(MsgPacket* header) {
+  std::map<uint32_t, MsgPacket*>::iterator i = m_buffers.find(header->getUID());
+
+  if(i == m_buffers.end()) {
+    return header;
+  }
+
+  // receive straight into the buffer supplied with the request
+  MsgPacket* buffer = i->second;
+  m_buffers.erase(i);
+
+  buffer->reuse(header);
+  delete header;
+
+  return buffer;
+}
@@ -0,0 +1,96 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <string>
+
+#include "xvdr/session.h"
+
+class MsgPacket;
+
+namespace XVDR {
+
+/**
+ * Extra session reading blocks of a recording.
+ *
+ * A bare session without a reader thread. The server answers the requests
+ * of a session in order, the responses are read on the caller's thread
+ * when they are collected. Responses read ahead of the one asked for are
+ * kept until they are collected or cancelled.
+ */
+class RecordingStripe : public Session {
+public:
+
+  RecordingStripe(int timeout_ms);
+  ~RecordingStripe();
+
+  /**
+   * Log in and open a recording.
+   */
+  bool OpenRecording(const std::string& hostname, const std::string& name, const std::string& recid);
+
+  /**
+   * Length of the recording in bytes when it was opened.
+   */
+  uint64_t RecordingLength() const {
+    return m_length;
+  }
+
+  /**
+   * Send a request, the response is received into buffer (if not NULL).
+   * The buffer is taken over in any case.
+   */
+  bool Send(MsgPacket* request, MsgPacket* buffer = NULL);
+
+  /**
+   * Get the response of a sent request, NULL on errors.
+   */
+  MsgPacket* Receive(MsgPacket* request);
+
+  /**
+   * Drop the response of a sent request.
+   */
+  void Cancel(MsgPacket* request);
+
+  /**
+   * Let the server know the recording has grown.
+   */
+  bool Update();
+
+protected:
+
+  MsgPacket* ReceiveBuffer(MsgPacket* header);
+
+private:
+
+  std::map<uint32_t, MsgPacket*> m_buffers;
+  std::map<uint32_t, MsgPacket*> m_received;
+  std::set<uint32_t> m_cancelled;
+  uint64_t m_length;
+};
+
+} // namespace XVDR
@@ -0,0 +1,260 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+#include <fstream>
+
+#include "xvdr/msgpacket.h"
+#include "responsecache.h"
+
+using namespace XVDR;
+
+// bump if the layout of the stored entries changes
+#define RESPONSECACHE_VERSION 1
+
+static void PutData(MsgPacket& p, const std::string& data) {
+  p.put_U32(data.size());
+  p.put_Blob((uint8_t*)data.data(), data.size());
+}
+
+static std::string GetData(MsgPacket& p) {
+  uint32_t length = p.get_U32();
+  const char* data = (const char*)p.consume(length);
+
+  return (data != NULL) ? std::string(data, length) : std::string();
+}
+
+ResponseCache::ResponseCache(uint16_t msgid) : m_msgid(msgid), m_dirty(false) {
+}
+
+bool ResponseCache::Load(const std::string& filename) {
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+
+  if(!in.is_open()) {
+    return false;
+  }
+
+  MsgPacket p;
+
+  if(!MsgPacket::readstream(in, p) || p.getMsgID() != m_msgid || p.get_U32() != RESPONSECACHE_VERSION) {
+    return false;
+  }
+
+  std::map<std::string, std::string> contexts;
+
+  for(uint32_t count = p.get_U32(); count > 0; count--) {
+    std::string name = p.get_String();
+    contexts[name] = GetData(p);
+  }
+
+  MutexLock lock(&m_lock);
+
+  // responses to other settings are of no use
+  for(std::map<std::string, std::string>::iterator i = m_contexts.begin(); i != m_contexts.end(); i++) {
+    std::map<std::string, std::string>::iterator c = contexts.find(i->first);
+
+    if(c == contexts.end() || c->second != i->second) {
+      return false;
+    }
+  }
+
+  // take over the settings not made yet
+  m_contexts.insert(contexts.begin(), contexts.end());
+  m_entries.clear();
+  m_outdated.clear();
+
+  while(!p.eop()) {
+    std::string key = GetData(p);
+    m_entries[key] = GetData(p);
+  }
+
+  m_dirty = false;
+  return true;
+}
+
+bool ResponseCache::Save(const std::string& filename) {
+  MsgPacket p(m_msgid);
+  p.put_U32(RESPONSECACHE_VERSION);
+
+  {
+    MutexLock lock(&m_lock);
+
+    p.put_U32(m_contexts.size());
+
+    for(std::map<std::string, std::string>::iterator i = m_contexts.begin(); i != m_contexts.end(); i++) {
+      p.put_String(i->first.c_str());
+      PutData(p, i->second);
+    }
+
+    for(std::map<std::string, std::string>::iterator i = m_entries.begin(); i != m_entries.end(); i++) {
+      PutData(p, i->first);
+      PutData(p, i->second);
+    }
+
+    m_dirty = false;
+  }
+
+  std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+  if(!out.is_open()) {
+    return false;
+  }
+
+  p.freeze();
+  out << p;
+
+  return out.good();
+}
+
+bool ResponseCache::SetContext(const std::string& name, const std::string& value) {
+  MutexLock lock(&m_lock);
+
+  std::map<std::string, std::string>::iterator i = m_contexts.find(name);
+
+  // the first value applies to the entries stored so far
+  if(i == m_contexts.end()) {
+    m_contexts[name] = value;
+    m_dirty = true;
+    return false;
+  }
+
+  if(i->second == value) {
+    return false;
+  }
+
+  i->second = value;
+
+  if(m_entries.empty()) {
+    return false;
+  }
+
+  m_entries.clear();
+  m_outdated.clear();
+  m_dirty = true;
+  return true;
+}
+
+MsgPacket* ResponseCache::Get(MsgPacket* request) {
+  std::string key = Key(request);
+
+  MutexLock lock(&m_lock);
+
+  std::map<std::string, std::string>::iterator i = m_entries.find(key);
+
+  if(i == m_entries.end() || m_outdated.find(key) != m_outdated.end()) {
+    return NULL;
+  }
+
+  MsgPacket* response = new MsgPacket(request->getMsgID(), request->getType(), request->getUID());
+
+  if(!i->second.empty()) {
+    memcpy(response->reserve(i->second.size()), i->second.data(), i->second.size());
+  }
+
+  return response;
+}
+
+bool ResponseCache::Contains(MsgPacket* request) {
+  std::string key = Key(request);
+
+  MutexLock lock(&m_lock);
+  return (m_entries.find(key) != m_entries.end() && m_outdated.find(key) == m_outdated.end());
+}
+
+bool ResponseCache::Put(MsgPacket* request, MsgPacket* response) {
+  return Put(request, std::string((const char*)response->getPayload(), response->getPayloadLength()));
+}
+
+bool ResponseCache::Put(MsgPacket* request, const std::string& payload) {
+  std::string key = Key(request);
+
+  MutexLock lock(&m_lock);
+
+  m_outdated.erase(key);
+
+  std::map<std::string, std::string>::iterator i = m_entries.find(key);
+
+  if(i != m_entries.end() && i->second == payload) {
+    return false;
+  }
+
+  m_entries[key] = payload;
+  m_dirty = true;
+  return true;
+}
+
+void ResponseCache::GetRequests(std::vector<MsgPacket*>& requests) {
+  MutexLock lock(&m_lock);
+
+  for(std::map<std::string, std::string>::iterator i = m_entries.begin(); i != m_entries.end(); i++) {
+    const uint8_t* key = (const uint8_t*)i->first.data();
+    uint32_t length = i->first.size() - sizeof(uint16_t);
+
+    MsgPacket* request = new MsgPacket((key[0] << 8) | key[1]);
+
+    if(length > 0) {
+      memcpy(request->reserve(length), key + sizeof(uint16_t), length);
+    }
+
+    requests.push_back(request);
+  }
+}
+
+void ResponseCache::Invalidate() {
+  MutexLock lock(&m_lock);
+
+  for(std::map<std::string, std::string>::iterator i = m_entries.begin(); i != m_entries.end(); i++) {
+    m_outdated.insert(i->first);
+  }
+}
+
+bool ResponseCache::Dirty() {
+  MutexLock lock(&m_lock);
+  return m_dirty;
+}
+
+int ResponseCache::Count() {
+  MutexLock lock(&m_lock);
+  return m_entries.size();
+}
+
+void ResponseCache::Clear() {
+  MutexLock lock(&m_lock);
+
+  m_entries.clear();
+  m_outdated.clear();
+  m_dirty = true;
+}
+
+std::string ResponseCache::Key(MsgPacket* request) {
+  // message id first (big endian), the entries are sorted by request type
+  uint16_t msgid = request->getMsgID();
+
+  std::string key;
+  key += (char)(msgid >> 8);
+  key += (char)(msgid & 0xff);
+  key.append((const char*)request->getPayload(), request->getPayloadLength());
+
+  return key;
+}
@@ -0,0 +1,139 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "xvdr/thread.h"
+
+class MsgPacket;
+
+namespace XVDR {
+
+/**
+ * Local copy of server responses.
+ *
+ * Responses are stored with the request they answer (message id and
+ * payload), so every entry can be requested again to check if it is still
+ * up to date. That check transfers the whole response again, the cache
+ * saves the wait at startup but no traffic. Responses may depend on settings sent earlier on the session
+ * (contexts), all entries are dropped if one of them changes.
+ * The cache can be stored on disk to be available right after startup.
+ */
+class ResponseCache {
+public:
+
+  /**
+   * @param msgid  tag of the stored file, to tell the caches apart
+   */
+  ResponseCache(uint16_t msgid);
+
+  /**
+   * Load the cache from a file written by Save().
+   *
+   * Entries recorded with other contexts than the current ones are dropped.
+   */
+  bool Load(const std::string& filename);
+
+  /**
+   * Write the cache to a file.
+   */
+  bool Save(const std::string& filename);
+
+  /**
+   * Set a value responses depend on.
+   *
+   * @return true if the value changed and the cache was cleared
+   */
+  bool SetContext(const std::string& name, const std::string& value);
+
+  /**
+   * Get a copy of the stored response to a request.
+   *
+   * @return the response (to be deleted by the caller) or NULL if not cached (or outdated)
+   */
+  MsgPacket* Get(MsgPacket* request);
+
+  /**
+   * Check if an up to date response to a request is stored.
+   */
+  bool Contains(MsgPacket* request);
+
+  /**
+   * Store the response to a request.
+   *
+   * @return true if the response differs from the stored one
+   */
+  bool Put(MsgPacket* request, MsgPacket* response);
+
+  /**
+   * Store the response payload to a request.
+   */
+  bool Put(MsgPacket* request, const std::string& payload);
+
+  /**
+   * Create the requests of all entries (to be deleted by the caller).
+   */
+  void GetRequests(std::vector<MsgPacket*>& requests);
+
+  /**
+   * Mark all entries as outdated.
+   *
+   * Get() doesn't return them until they are stored again, the stored
+   * responses are still used to tell if a new one differs.
+   */
+  void Invalidate();
+
+  /**
+   * Check if entries were stored since the last Load() or Save().
+   */
+  bool Dirty();
+
+  /**
+   * Number of stored responses.
+   */
+  int Count();
+
+  /**
+   * Remove all entries.
+   */
+  void Clear();
+
+private:
+
+  static std::string Key(MsgPacket* request);
+
+  uint16_t m_msgid;
+  std::map<std::string, std::string> m_entries;
+  std::map<std::string, std::string> m_contexts;
+  std::set<std::string> m_outdated;
+  bool m_dirty;
+  Mutex m_lock;
+};
+
+} // namespace XVDR
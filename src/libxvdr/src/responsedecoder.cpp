@@ -0,0 +1,106 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+
+#include "xvdr/msgpacket.h"
+#include "responsedecoder.h"
+
+using namespace XVDR;
+
+ResponseDecoder::ResponseDecoder(const char* layout) : m_layout(layout) {
+}
+
+ResponseDecoder::~ResponseDecoder() {
+}
+
+void ResponseDecoder::Feed(MsgPacket* part) {
+  const uint8_t* data = part->getPayload();
+  int length = part->getPayloadLength();
+
+  // complete the item split by the previous part
+  if(!m_rest.empty()) {
+    m_rest.append((const char*)data, length);
+    data = (const uint8_t*)m_rest.data();
+    length = m_rest.size();
+  }
+
+  int used = 0;
+  int size = 0;
+
+  while((size = ItemLength(data + used, length - used)) > 0) {
+    used += size;
+  }
+
+  if(used == length && m_rest.empty()) {
+    Decode(part);
+    return;
+  }
+
+  if(used > 0) {
+    MsgPacket items(part->getMsgID(), part->getType(), part->getUID());
+    memcpy(items.reserve(used), data, used);
+    Decode(&items);
+  }
+
+  m_rest = std::string((const char*)data + used, length - used);
+}
+
+bool ResponseDecoder::Finish() {
+  return m_rest.empty();
+}
+
+int ResponseDecoder::ItemLength(const uint8_t* data, int length) {
+  int pos = 0;
+
+  for(const char* f = m_layout; *f != 0; f++) {
+    switch(*f) {
+      case 'B':
+        pos += sizeof(uint8_t);
+        break;
+      case 'U':
+        pos += sizeof(uint32_t);
+        break;
+      case 'Q':
+        pos += sizeof(uint64_t);
+        break;
+      case 'S': {
+        const uint8_t* end = (pos < length) ? (const uint8_t*)memchr(data + pos, 0, length - pos) : NULL;
+
+        if(end == NULL) {
+          return 0;
+        }
+
+        pos = end - data + 1;
+        break;
+      }
+    }
+
+    if(pos > length) {
+      return 0;
+    }
+  }
+
+  return pos;
+}
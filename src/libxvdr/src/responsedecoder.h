@@ -0,0 +1,72 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <string>
+
+class MsgPacket;
+
+namespace XVDR {
+
+/**
+ * Decoder for the items of a list response.
+ *
+ * Large responses are passed in parts while they are received, so decoding
+ * overlaps the transfer and the whole payload is never kept. Items may be
+ * split between parts; Decode() is only called with complete items.
+ */
+class ResponseDecoder {
+public:
+
+  /**
+   * Layout of an item: 'B' uint8, 'U' uint32, 'Q' uint64, 'S' string.
+   */
+  ResponseDecoder(const char* layout);
+
+  virtual ~ResponseDecoder();
+
+  /**
+   * Decode the items of the next part of the payload.
+   */
+  void Feed(MsgPacket* part);
+
+  /**
+   * Check that the payload didn't end within an item.
+   */
+  bool Finish();
+
+protected:
+
+  virtual void Decode(MsgPacket* items) = 0;
+
+private:
+
+  int ItemLength(const uint8_t* data, int length);
+
+  const char* m_layout;
+  std::string m_rest;
+};
+
+} // namespace XVDR
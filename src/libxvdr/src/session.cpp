@@ -23,6 +23,16 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <vector>
+
 #include "xvdr/clientinterface.h"
 #include "xvdr/session.h"
 #include "xvdr/msgpacket.h"
@@ -38,13 +48,17 @@
 #include <sys/stat.h>
 
 #include "os-config.h"
+#include "responsedecoder.h"
 
 using namespace XVDR;
 
+#define SESSION_PARTSIZE (64 * 1024) // parts of a response read with ReadStream()
+
 Session::Session()
   : m_timeout(3000)
   , m_fd(INVALID_SOCKET)
   , m_connectionLost(false)
+  , m_decoder(NULL)
 {
   m_port = 34891;
 }
@@ -168,14 +182,174 @@ bool Session::IsOpen()
 MsgPacket* Session::ReadMessage()
 {
   bool bClosed = false;
-  MsgPacket* p = MsgPacket::read(m_fd, bClosed, m_timeout);
+  MsgPacket* p = MsgPacket::readheader(m_fd, bClosed, m_timeout);
 
   if(bClosed)
     SignalConnectionLost();
 
+  if(p == NULL)
+    return NULL;
+
+  // receive the payload into the buffer the session prefers
+  p = ReceiveBuffer(p);
+
+  uint32_t partsize = ReceivePartSize(p);
+
+#ifndef HAVE_ZLIB
+  // can't be uncompressed in parts
+  if(p->isCompressed())
+    partsize = 0;
+#endif
+
+  if(partsize > 0 ? !ReadPayloadParts(p, partsize) : !p->readpayload(m_fd, m_timeout))
+  {
+    delete p;
+    return NULL;
+  }
+
   return p;
 }
 
+MsgPacket* Session::ReceiveBuffer(MsgPacket* header)
+{
+  return header;
+}
+
+uint32_t Session::ReceivePartSize(MsgPacket* header)
+{
+  if(m_decoder == NULL || header->getHeaderPayloadLength() <= SESSION_PARTSIZE)
+    return 0;
+
+  return SESSION_PARTSIZE;
+}
+
+void Session::ReceivePart(MsgPacket*, MsgPacket* part)
+{
+  // a broken response fails in ReadMessage(), the decoder's items are dropped
+  // by its owner
+  if(part != NULL && m_decoder != NULL)
+    m_decoder->Feed(part);
+
+  delete part;
+}
+
+bool Session::ReadPayloadParts(MsgPacket* header, uint32_t partsize)
+{
+  uint32_t checksum = 0;
+  bool complete = header->isCompressed() ? ReadCompressedParts(header, partsize, checksum) : ReadParts(header, partsize, checksum);
+
+  // the parts have been passed on already, the receiver must drop them
+  if(!complete || (header->getPayloadCheckSum() != 0 && header->getPayloadCheckSum() != checksum))
+  {
+    ReceivePart(header, NULL);
+    return false;
+  }
+
+  return true;
+}
+
+bool Session::ReadParts(MsgPacket* header, uint32_t partsize, uint32_t& checksum)
+{
+  uint32_t length = header->getHeaderPayloadLength();
+
+  for(uint32_t done = 0; done < length;)
+  {
+    uint32_t size = (length - done < partsize) ? length - done : partsize;
+
+    MsgPacket* part = new MsgPacket(header->getMsgID(), header->getType(), header->getUID());
+    uint8_t* data = part->reserve(size);
+
+    if(data == NULL || socketread(m_fd, data, size, m_timeout) != 0)
+    {
+      delete part;
+      return false;
+    }
+
+    checksum = MsgPacket::crc32(data, size, checksum);
+    done += size;
+
+    ReceivePart(header, part);
+  }
+
+  return true;
+}
+
+bool Session::ReadCompressedParts(MsgPacket* header, uint32_t partsize, uint32_t& checksum)
+{
+#ifndef HAVE_ZLIB
+  return false;
+#else
+  uint32_t length = header->getHeaderPayloadLength();
+  std::vector<uint8_t> in(partsize);
+  std::vector<uint8_t> out(partsize);
+
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+
+  if(inflateInit(&z) != Z_OK)
+    return false;
+
+  int rc = Z_OK;
+  uint32_t used = 0;
+
+  // uncompress while reading, the parts passed on are full (except the last one)
+  for(uint32_t done = 0; done < length;)
+  {
+    uint32_t size = (length - done < partsize) ? length - done : partsize;
+
+    if(socketread(m_fd, &in[0], size, m_timeout) != 0)
+    {
+      inflateEnd(&z);
+      return false;
+    }
+
+    checksum = MsgPacket::crc32(&in[0], size, checksum);
+    done += size;
+
+    // broken or finished, but the payload is read up to the end
+    if(rc != Z_OK)
+      continue;
+
+    z.next_in = &in[0];
+    z.avail_in = size;
+
+    do
+    {
+      z.next_out = &out[used];
+      z.avail_out = partsize - used;
+
+      rc = inflate(&z, Z_NO_FLUSH);
+
+      // all input taken, no output pending
+      if(rc == Z_BUF_ERROR)
+      {
+        rc = Z_OK;
+        break;
+      }
+
+      if(rc != Z_OK && rc != Z_STREAM_END)
+        break;
+
+      used = partsize - z.avail_out;
+
+      if(used == partsize || (rc == Z_STREAM_END && used > 0))
+      {
+        MsgPacket* part = new MsgPacket(header->getMsgID(), header->getType(), header->getUID());
+        memcpy(part->reserve(used), &out[0], used);
+        ReceivePart(header, part);
+        used = 0;
+      }
+    }
+    while(rc == Z_OK && (z.avail_in > 0 || z.avail_out == 0));
+  }
+
+  inflateEnd(&z);
+
+  // the payload must hold the whole stream
+  return (rc == Z_STREAM_END);
+#endif
+}
+
 bool Session::TransmitMessage(MsgPacket* vrp)
 {
   return vrp->write(m_fd, m_timeout);
@@ -189,6 +363,22 @@ MsgPacket* Session::ReadResult(MsgPacket* vrp)
   return ReadMessage();
 }
 
+bool Session::ReadStream(MsgPacket* vrp, ResponseDecoder& decoder)
+{
+  m_decoder = &decoder;
+  MsgPacket* vresp = ReadResult(vrp);
+  m_decoder = NULL;
+
+  if(vresp == NULL)
+    return false;
+
+  // the whole payload or the header of a response read in parts
+  decoder.Feed(vresp);
+  delete vresp;
+
+  return decoder.Finish();
+}
+
 void Session::OnReconnect() {
 }
 
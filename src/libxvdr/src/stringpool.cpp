@@ -0,0 +1,206 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+
+#include "stringpool.h"
+
+using namespace XVDR;
+
+// strings are packed into blocks of this size
+#define POOL_BLOCKSIZE (64 * 1024)
+
+// longer strings get a block of their own
+#define POOL_LARGE 1024
+
+// space is handed out (and reused) in steps of this size
+#define POOL_ALIGN 8
+
+#define POOL_HEADER ((sizeof(String) + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1))
+
+StringPool::StringPool() : m_block(NULL), m_left(0), m_count(0) {
+  Resize(1024);
+}
+
+StringPool::~StringPool() {
+  Clear();
+}
+
+const char* StringPool::Intern(const char* s) {
+  // FNV-1a
+  uint32_t hash = 2166136261U;
+  size_t length = 0;
+
+  for(const char* c = s; *c != 0; c++, length++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619U;
+  }
+
+  String** bucket = &m_table[hash & (m_table.size() - 1)];
+
+  for(String* i = *bucket; i != NULL; i = i->next) {
+    if(i->hash == hash && i->length == length && memcmp((char*)i + POOL_HEADER, s, length) == 0) {
+      i->refs++;
+      return (char*)i + POOL_HEADER;
+    }
+  }
+
+  String* i = Allocate(length);
+  i->hash = hash;
+  i->length = length;
+  i->refs = 1;
+  i->next = *bucket;
+  *bucket = i;
+
+  char* chars = (char*)i + POOL_HEADER;
+  memcpy(chars, s, length + 1);
+
+  if(++m_count > m_table.size()) {
+    Resize(m_table.size() * 2);
+  }
+
+  return chars;
+}
+
+void StringPool::Release(const char* s) {
+  if(s == NULL) {
+    return;
+  }
+
+  String* i = (String*)(s - POOL_HEADER);
+
+  if(--i->refs > 0) {
+    return;
+  }
+
+  String** p = &m_table[i->hash & (m_table.size() - 1)];
+
+  while(*p != i) {
+    p = &(*p)->next;
+  }
+
+  *p = i->next;
+  m_count--;
+
+  Free(i, Size(i->length));
+}
+
+void StringPool::Clear() {
+  // large strings are allocated one by one
+  for(std::vector<String*>::iterator b = m_table.begin(); b != m_table.end(); b++) {
+    for(String* i = *b; i != NULL;) {
+      String* next = i->next;
+
+      if(Size(i->length) > POOL_LARGE) {
+        delete[] (char*)i;
+      }
+
+      i = next;
+    }
+
+    *b = NULL;
+  }
+
+  for(std::vector<char*>::iterator i = m_blocks.begin(); i != m_blocks.end(); i++) {
+    delete[] *i;
+  }
+
+  m_blocks.clear();
+  m_unused.clear();
+  m_block = NULL;
+  m_left = 0;
+  m_count = 0;
+}
+
+size_t StringPool::Count() {
+  return m_count;
+}
+
+size_t StringPool::Size(size_t length) {
+  return (POOL_HEADER + length + POOL_ALIGN) & ~(POOL_ALIGN - 1);
+}
+
+StringPool::String* StringPool::Allocate(size_t length) {
+  size_t size = Size(length);
+  String* s = NULL;
+
+  if(size > POOL_LARGE) {
+    s = (String*)new char[size];
+  }
+  else if(size / POOL_ALIGN < m_unused.size() && m_unused[size / POOL_ALIGN] != NULL) {
+    s = m_unused[size / POOL_ALIGN];
+    m_unused[size / POOL_ALIGN] = s->next;
+  }
+  else {
+    if(m_left < size) {
+      // the rest of the full block is left for shorter strings
+      if(m_left >= Size(0)) {
+        Free((String*)m_block, m_left);
+      }
+
+      m_block = new char[POOL_BLOCKSIZE];
+      m_left = POOL_BLOCKSIZE;
+      m_blocks.push_back(m_block);
+    }
+
+    s = (String*)m_block;
+    m_block += size;
+    m_left -= size;
+  }
+
+  return s;
+}
+
+void StringPool::Free(String* s, size_t size) {
+  if(size > POOL_LARGE) {
+    delete[] (char*)s;
+    return;
+  }
+
+  // keep the space for the next string of the same size
+  size_t n = size / POOL_ALIGN;
+
+  if(n >= m_unused.size()) {
+    m_unused.resize(n + 1, NULL);
+  }
+
+  s->next = m_unused[n];
+  m_unused[n] = s;
+}
+
+void StringPool::Resize(size_t buckets) {
+  std::vector<String*> table(buckets, NULL);
+
+  for(std::vector<String*>::iterator b = m_table.begin(); b != m_table.end(); b++) {
+    for(String* i = *b; i != NULL;) {
+      String* next = i->next;
+      String** bucket = &table[i->hash & (buckets - 1)];
+
+      i->next = *bucket;
+      *bucket = i;
+      i = next;
+    }
+  }
+
+  m_table.swap(table);
+}
@@ -0,0 +1,95 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace XVDR {
+
+/**
+ * Pool of shared strings.
+ *
+ * Titles of daily shows, descriptions of reruns, channel names and folders
+ * repeat all over the guide and the recordings list. The pool stores each
+ * of them once and counts the references, two interned strings are equal
+ * if their pointers are. The strings are packed into large blocks, the
+ * space of released ones is reused for strings of the same size. The pool
+ * doesn't lock, that's up to the owner.
+ */
+class StringPool {
+public:
+
+  StringPool();
+
+  ~StringPool();
+
+  /**
+   * Get the shared copy of a string, valid until released.
+   */
+  const char* Intern(const char* s);
+
+  /**
+   * Drop a reference taken by Intern().
+   */
+  void Release(const char* s);
+
+  /**
+   * Drop all strings, once the owner dropped all references.
+   */
+  void Clear();
+
+  /**
+   * Number of distinct strings.
+   */
+  size_t Count();
+
+private:
+
+  // header of a string, the characters follow
+  struct String {
+    String* next;
+    uint32_t hash;
+    uint32_t length;
+    int refs;
+  };
+
+  static size_t Size(size_t length);
+
+  String* Allocate(size_t length);
+
+  void Free(String* s, size_t size);
+
+  void Resize(size_t buckets);
+
+  std::vector<String*> m_table;
+  std::vector<String*> m_unused;
+  std::vector<char*> m_blocks;
+  char* m_block;
+  size_t m_left;
+  size_t m_count;
+};
+
+} // namespace XVDR
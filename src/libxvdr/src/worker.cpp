@@ -0,0 +1,88 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "xvdr/connection.h"
+#include "worker.h"
+
+using namespace XVDR;
+
+Worker::Worker(Connection* connection) : m_connection(connection), m_tasks(0), m_deferred(0), m_due(0) {
+}
+
+Worker::~Worker() {
+  Cancel(-1);
+  m_event.Signal();
+  Cancel(5);
+}
+
+void Worker::Schedule(int tasks, int delay_ms) {
+  MutexLock lock(&m_lock);
+
+  if(delay_ms > 0) {
+    uint64_t due = TimeMs::Now() + delay_ms;
+
+    // the earliest of the collected tasks is kept waiting for
+    if(m_deferred == 0 || due < m_due) {
+      m_due = due;
+      m_event.Signal();
+    }
+
+    m_deferred |= tasks;
+    return;
+  }
+
+  m_tasks |= tasks;
+  m_event.Signal();
+}
+
+void Worker::Action() {
+  while(Running()) {
+    m_lock.Lock();
+    uint64_t now = TimeMs::Now();
+    int timeout = 1000;
+
+    if(m_deferred != 0 && m_due < now + timeout) {
+      timeout = (m_due > now) ? (int)(m_due - now) : 1;
+    }
+
+    m_lock.Unlock();
+
+    m_event.Wait(timeout);
+
+    m_lock.Lock();
+
+    if(m_deferred != 0 && TimeMs::Now() >= m_due) {
+      m_tasks |= m_deferred;
+      m_deferred = 0;
+    }
+
+    int tasks = m_tasks;
+    m_tasks = 0;
+    m_lock.Unlock();
+
+    if(tasks != 0 && Running()) {
+      m_connection->RunTasks(tasks);
+    }
+  }
+}
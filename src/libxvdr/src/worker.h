@@ -0,0 +1,67 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "xvdr/thread.h"
+
+namespace XVDR {
+
+class Connection;
+
+/**
+ * Background thread of a connection.
+ *
+ * Runs the tasks scheduled by the connection (bit flags) outside of the
+ * thread receiving the server messages, so they can send requests and
+ * wait for the responses.
+ */
+class Worker : public Thread {
+public:
+
+  Worker(Connection* connection);
+  ~Worker();
+
+  /**
+   * Run the tasks as soon as possible or after a delay.
+   *
+   * Tasks scheduled with a delay are collected, they run together when
+   * the earliest of them is due.
+   */
+  void Schedule(int tasks, int delay_ms = 0);
+
+protected:
+
+  void Action();
+
+private:
+
+  Connection* m_connection;
+  int m_tasks;
+  int m_deferred;
+  uint64_t m_due;
+  Mutex m_lock;
+  CondWait m_event;
+};
+
+} // namespace XVDR
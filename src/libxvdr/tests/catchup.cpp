@@ -0,0 +1,130 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "consoleclient.h"
+#include "standinserver.h"
+#include "xvdr/demux.h"
+
+using namespace XVDR;
+
+// read the live stream like a player for a while
+static void Play(ConsoleClient& client, Demux& demux, int ms) {
+  TimeMs t;
+
+  while(t.Elapsed() < (uint64_t)ms) {
+    ConsoleClient::Packet* p = demux.Read<ConsoleClient::Packet>();
+
+    if(p == NULL) {
+      return;
+    }
+
+    client.FreePacket((XVDR::Packet*)p);
+  }
+}
+
+// stall the player, then read the next packet and check how far it is behind live
+static int Stall(ConsoleClient& client, Demux& demux, int ms) {
+  CondWait::SleepMs(ms);
+  client.FreePacket(demux.Read());
+
+  return demux.GetLiveLatency();
+}
+
+int main(int argc, char* argv[]) {
+  int rtt = 20;
+  int catchup = 1000;
+  int stall = 2500;
+
+  if(argc >= 2) {
+    rtt = atoi(argv[1]);
+  }
+
+  // the server clock is an hour and a bit ahead
+  int offset = 3600 * 1000 + 300;
+
+  StandInServer server(0, rtt);
+  server.SetClockOffset(offset);
+
+  if(!server.Listen()) {
+    printf("unable to start the stand-in server\n");
+    return 1;
+  }
+
+  ConsoleClient client;
+  Demux demux(&client, NULL);
+
+  if(demux.OpenChannel("127.0.0.1", 1) != Demux::SC_OK) {
+    printf("open channel: FAILED\n");
+    return 1;
+  }
+
+  // the server only reports full seconds
+  int64_t estimate = demux.GetClockOffset();
+
+  printf("server clock offset: %lli ms (actual %i ms)\n", (long long)estimate, offset);
+
+  if(estimate < offset - 1000 || estimate > offset + 1000) {
+    printf("clock offset: FAILED\n");
+    return 1;
+  }
+
+  Play(client, demux, 1000);
+
+  int latency = demux.GetLiveLatency();
+  printf("playing: %i ms behind live\n", latency);
+
+  if(latency > catchup / 2) {
+    printf("playing: FAILED\n");
+    return 1;
+  }
+
+  // without catching up the player stays behind after a stall
+  demux.SetCatchUp(0);
+  latency = Stall(client, demux, stall);
+  printf("stalled %i ms, catch-up off: %i ms behind live\n", stall, latency);
+
+  if(latency < stall - 500) {
+    printf("catch-up off: FAILED\n");
+    return 1;
+  }
+
+  // reading the backlog (faster than live) gets back to the live edge
+  Play(client, demux, stall);
+
+  // with catching up the queue is skipped at a keyframe beyond the threshold
+  demux.SetCatchUp(catchup);
+  latency = Stall(client, demux, stall);
+  printf("stalled %i ms, catch-up after %i ms: %i ms behind live\n", stall, catchup, latency);
+
+  if(latency > catchup) {
+    printf("catch-up on: FAILED\n");
+    return 1;
+  }
+
+  demux.CloseChannel();
+  return 0;
+}
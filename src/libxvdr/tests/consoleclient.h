@@ -49,6 +49,8 @@ public:
   void TransferRecordingEntry(const XVDR::RecordingEntry&) {}
   void TransferChannelGroup(const XVDR::ChannelGroup&) {}
   void TransferChannelGroupMember(const XVDR::ChannelGroupMember&) {}
+  void TransferEpgEntryRef(const XVDR::EpgItemRef&) {}
+  void TransferRecordingEntryRef(const XVDR::RecordingEntryRef&) {}
 
   XVDR::Packet* StreamChange(const XVDR::StreamProperties& streams);
 
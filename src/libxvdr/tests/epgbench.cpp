@@ -0,0 +1,287 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <new>
+
+#include "xvdr/command.h"
+#include "consoleclient.h"
+#include "standinserver.h"
+#include "../src/epgstore.h"
+#include "../src/recordingindex.h"
+
+using namespace XVDR;
+
+static const char* folder = "epgbench.store";
+static const char* prefetchfolder = "epgbench.prefetch";
+
+static volatile long allocations = 0;
+static volatile long allocated = 0;
+
+// every block starts with its size, to keep track of the memory in use
+void* operator new(size_t size) {
+  __sync_fetch_and_add(&allocations, 1);
+  __sync_fetch_and_add(&allocated, (long)size);
+  size_t* p = (size_t*)malloc(size + 16);
+
+  if(p == NULL) {
+    throw std::bad_alloc();
+  }
+
+  *p = size;
+  return (char*)p + 16;
+}
+
+void operator delete(void* p) throw() {
+  if(p == NULL) {
+    return;
+  }
+
+  size_t* block = (size_t*)((char*)p - 16);
+  __sync_fetch_and_sub(&allocated, (long)*block);
+  free(block);
+}
+
+void operator delete(void* p, size_t) throw() {
+  operator delete(p);
+}
+
+// decode captured responses of all channels into a store and pass them on
+static void DecodeGuide(ConsoleClient& client, StandInServer& server, int channels, time_t start, time_t end) {
+  std::vector<MsgPacket*> responses;
+  int events = 0;
+
+  for(int uid = 1; uid <= channels; uid++) {
+    MsgPacket* p = new MsgPacket(XVDR_EPG_GETFORCHANNEL);
+
+    for(uint32_t t = start - start % StandInServer::EventLength; t < end; t += StandInServer::EventLength) {
+      *p << server.GuideEvent(uid, t);
+      events++;
+    }
+
+    responses.push_back(p);
+  }
+
+  // best of a few rounds, the first one warms up the heap
+  int best = 0;
+  long count = 0;
+  long used = 0;
+
+  for(int round = 0; round < 5; round++) {
+    EpgStore store;
+    long a = allocations;
+    long b = allocated;
+    TimeMs t;
+
+    for(int uid = 1; uid <= channels; uid++) {
+      responses[uid - 1]->rewind();
+      store.Update(uid, start, end, responses[uid - 1]);
+      store.Transfer(&client, uid, start, end);
+    }
+
+    int elapsed = (int)t.Elapsed();
+    count = allocations - a;
+    used = allocated - b;
+
+    if(round == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  printf("%-24s %6i ms, %i events, %li allocations, %li kB in use\n", "decode:", best, events, count, used / 1024);
+
+  for(std::vector<MsgPacket*>::iterator i = responses.begin(); i != responses.end(); i++) {
+    delete *i;
+  }
+}
+
+// memory of a recording index holding a library with series, folders and a few channels
+static void IndexLibrary(int recordings) {
+  MsgPacket list(XVDR_RECORDINGS_GETLIST);
+
+  for(int i = 0; i < recordings; i++) {
+    char text[256];
+    RecordingEntry rec;
+
+    sprintf(text, "rec%i", i);
+    rec.Id = text;
+    sprintf(text, "Channel %i", i % 20);
+    rec.ChannelName = text;
+    sprintf(text, "Series %i", i % 100);
+    rec.Title = text;
+    sprintf(text, "Series/Series %i", i % 100);
+    rec.Directory = text;
+    sprintf(text, "Episode %i", i / 100);
+    rec.PlotOutline = text;
+    sprintf(text, "Episode %i of series %i. This text is about as long as the description of a real recording, "
+                  "so the memory in use matches a real library.", i / 100, i % 100);
+    rec.Plot = text;
+
+    list << rec;
+  }
+
+  list.rewind();
+
+  RecordingIndex index;
+  long b = allocated;
+  index.Update(&list);
+
+  printf("%-24s %i recordings, %li kB in use\n", "recording index:", recordings, (allocated - b) / 1024);
+}
+
+// fetch the guide of all channels, prints the time, number of requests and bytes transferred
+static bool FetchGuide(const char* name, ConsoleClient& client, StandInServer& server, int channels, time_t start, time_t end) {
+  int requests = server.Requests();
+  uint64_t bytes = server.Bytes();
+  TimeMs t;
+
+  for(int uid = 1; uid <= channels; uid++) {
+    if(!client.GetEPGForChannel(uid, start, end)) {
+      printf("%s: FAILED\n", name);
+      return false;
+    }
+  }
+
+  printf("%-24s %6i ms, %4i requests, %7i kB\n", name, (int)t.Elapsed(), server.Requests() - requests, (int)((server.Bytes() - bytes) / 1024));
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  int rtt = 20;
+  int channels = 50;
+  int days = 14;
+
+  if(argc >= 2) {
+    rtt = atoi(argv[1]);
+  }
+  if(argc >= 3) {
+    channels = atoi(argv[2]);
+  }
+
+  StandInServer server(0, rtt);
+
+  if(!server.Listen()) {
+    printf("unable to start the stand-in server\n");
+    return 1;
+  }
+
+  time_t now = time(NULL);
+  time_t end = now + days * 24 * 3600;
+
+  printf("%i channels, %i days, rtt %i ms\n", channels, days, rtt);
+
+  {
+    ConsoleClient client;
+
+    if(!client.Open("127.0.0.1", "epgbench") || !client.SetEpgStore(folder)) {
+      return 1;
+    }
+
+    if(!FetchGuide("empty store:", client, server, channels, now, end) ||
+       !FetchGuide("same window again:", client, server, channels, now, end) ||
+       !FetchGuide("one more day:", client, server, channels, now, end + 24 * 3600)) {
+      return 1;
+    }
+  }
+
+  // a new client starts with the stored guide
+  {
+    ConsoleClient client;
+
+    if(!client.Open("127.0.0.1", "epgbench") || !client.SetEpgStore(folder)) {
+      return 1;
+    }
+
+    if(!FetchGuide("after restart:", client, server, channels, now, end)) {
+      return 1;
+    }
+  }
+
+  // steady state: the whole stored guide is outdated, a few events changed
+  {
+    ConsoleClient client;
+
+    if(!client.Open("127.0.0.1", "epgbench") || !client.SetEpgStore(folder, 0)) {
+      return 1;
+    }
+
+    server.SetGuideRevision(1);
+    CondWait::SleepMs(1100);
+
+    if(!FetchGuide("refresh:", client, server, channels, now, end)) {
+      return 1;
+    }
+  }
+
+  {
+    ConsoleClient client;
+    DecodeGuide(client, server, channels, now, end);
+  }
+
+  IndexLibrary(2000);
+
+  // the guide of the next day is loaded in the background while idle
+  {
+    ConsoleClient client;
+    server.SetChannels(channels);
+
+    if(!client.Open("127.0.0.1", "epgbench") || !client.SetEpgStore(prefetchfolder) || !client.GetChannelsList(false)) {
+      return 1;
+    }
+
+    int requests = server.Requests();
+    TimeMs t;
+    client.SetEpgPrefetch(24, 20);
+
+    // wait until the server is quiet
+    int last = -1;
+
+    while(server.Requests() != last && t.Elapsed() < 60000) {
+      last = server.Requests();
+      CondWait::SleepMs(1500);
+    }
+
+    printf("%-24s %6i ms, %4i requests\n", "prefetch, 24 hours:", (int)t.Elapsed(), server.Requests() - requests);
+
+    if(!FetchGuide("after prefetch:", client, server, channels, now, now + 24 * 3600)) {
+      return 1;
+    }
+  }
+
+  const char* folders[] = { folder, prefetchfolder };
+
+  for(int f = 0; f < 2; f++) {
+    for(int uid = 1; uid <= channels; uid++) {
+      char filename[64];
+      sprintf(filename, "%s/epg-%08x.dat", folders[f], uid);
+      remove(filename);
+    }
+
+    remove(folders[f]);
+  }
+
+  return 0;
+}
@@ -0,0 +1,374 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "xvdr/command.h"
+
+#include "consoleclient.h"
+#include "standinserver.h"
+
+using namespace XVDR;
+
+// counts what arrives instead of storing it
+class ListClient : public ConsoleClient {
+public:
+
+  ListClient() : m_batches(0), m_items(0), m_first(0), m_groups(0), m_members(0), m_triggers(0), m_timers(0), m_timertriggers(0) {
+  }
+
+  void Start() {
+    m_batches = 0;
+    m_items = 0;
+    m_first = 0;
+    m_time.Set();
+  }
+
+  void TransferChannelEntries(const std::vector<const Channel*>& channels) {
+    if(m_batches++ == 0) {
+      m_first = (int)m_time.Elapsed();
+    }
+
+    m_items += channels.size();
+  }
+
+  void TransferChannelGroup(const ChannelGroup&) {
+    m_groups++;
+  }
+
+  void TransferChannelGroupMember(const ChannelGroupMember&) {
+    m_members++;
+  }
+
+  void TriggerChannelUpdate() {
+    m_triggers++;
+  }
+
+  void TransferTimerEntries(const std::vector<const Timer*>& timers) {
+    m_timers = timers.size();
+  }
+
+  void TriggerTimerUpdate() {
+    m_timertriggers++;
+  }
+
+  void TriggerRecordingUpdate() {
+  }
+
+  // what XBMC does after a timer update
+  bool LoadTimers() {
+    return GetTimersCount() >= 0 && GetTimersList();
+  }
+
+  // everything the channel list in XBMC asks for
+  bool LoadChannels() {
+    if(!GetChannelsList(false)) {
+      return false;
+    }
+
+    int count = GetChannelGroupCount(false);
+
+    if(!GetChannelGroupList(false) || m_groups != count) {
+      return false;
+    }
+
+    for(int n = 1; n <= count; n++) {
+      char name[64];
+      sprintf(name, "Group %i", n);
+
+      if(!GetChannelGroupMembers(name, false)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  int m_batches;
+  int m_items;
+  int m_first;
+  int m_groups;
+  int m_members;
+  int m_triggers;
+  int m_timers;
+  int m_timertriggers;
+  TimeMs m_time;
+};
+
+// wait until the server doesn't get requests anymore
+static void WaitIdle(StandInServer& server) {
+  int requests = -1;
+
+  while(server.Requests() != requests) {
+    requests = server.Requests();
+    CondWait::SleepMs(1000);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  int rtt = 20;
+  int channels = 20000;
+  int bandwidth = 10000;
+
+  if(argc >= 2) {
+    rtt = atoi(argv[1]);
+  }
+  if(argc >= 3) {
+    channels = atoi(argv[2]);
+  }
+  if(argc >= 4) {
+    bandwidth = atoi(argv[3]);
+  }
+
+  StandInServer server(0, rtt);
+  server.SetChannels(channels);
+  server.SetBandwidth(bandwidth);
+
+  if(!server.Listen()) {
+    printf("unable to start the stand-in server\n");
+    return 1;
+  }
+
+  printf("%i channels, rtt %i ms, %i kB/s\n", channels, rtt, bandwidth);
+
+  ListClient client;
+
+  if(!client.Open("127.0.0.1", "listbench")) {
+    return 1;
+  }
+
+  uint64_t bytes = server.Bytes();
+  client.Start();
+
+  if(!client.GetChannelsList(false) || client.m_items != channels) {
+    printf("channel list: FAILED\n");
+    return 1;
+  }
+
+  int kbytes = (int)((server.Bytes() - bytes) / 1024);
+
+  printf("channel list: %i kB, first channels after %i ms, all after %i ms (%i batches)\n",
+         kbytes, client.m_first, (int)client.m_time.Elapsed(), client.m_batches);
+
+  // the same list compressed, uncompressed while it arrives
+  server.SetCompression(2);
+  bytes = server.Bytes();
+  client.Start();
+
+  if(!client.GetChannelsList(false) || client.m_items != channels) {
+    printf("compressed channel list: FAILED\n");
+    return 1;
+  }
+
+  kbytes = (int)((server.Bytes() - bytes) / 1024);
+
+  printf("compressed channel list: %i kB, first channels after %i ms, all after %i ms (%i batches)\n",
+         kbytes, client.m_first, (int)client.m_time.Elapsed(), client.m_batches);
+
+  server.SetCompression(0);
+
+  // a damaged list fails as soon as it is read, not after the timeout
+  server.SetBrokenResponses(true);
+  client.Start();
+
+  bool accepted = client.GetChannelsList(false);
+
+  printf("broken channel list: %s after %i ms\n", accepted ? "ACCEPTED" : "rejected", (int)client.m_time.Elapsed());
+  server.SetBrokenResponses(false);
+
+  if(accepted) {
+    return 1;
+  }
+
+  // fill the channel cache like the first start of XBMC does
+  const char* filename = "listbench.cache";
+  remove(filename);
+
+  {
+    ListClient first;
+
+    if(!first.Open("127.0.0.1", "listbench") || !first.EnableStatusInterface(true)) {
+      return 1;
+    }
+
+    first.SetChannelCache(filename);
+    first.Start();
+
+    if(!first.LoadChannels()) {
+      printf("first start: FAILED\n");
+      return 1;
+    }
+
+    printf("first start: channels and %i groups after %i ms\n", first.m_groups, (int)first.m_time.Elapsed());
+  }
+
+  // the next start is served from the cache, the server is asked in the background
+  ListClient cached;
+
+  if(!cached.Open("127.0.0.1", "listbench") || !cached.EnableStatusInterface(true)) {
+    return 1;
+  }
+
+  int requests = server.Requests();
+  bytes = server.Bytes();
+
+  cached.Start();
+
+  if(!cached.SetChannelCache(filename) || !cached.LoadChannels() || cached.m_items != channels) {
+    printf("cached start: FAILED\n");
+    return 1;
+  }
+
+  printf("cached start: channels and %i groups after %i ms\n", cached.m_groups, (int)cached.m_time.Elapsed());
+
+  // wait for the verification (all cached requests again, the list is the slowest)
+  int entries = 3 + cached.m_groups;
+  int wait = 2 * rtt + kbytes * 1000 / (bandwidth > 0 ? bandwidth : 100000) + 500;
+
+  for(int i = 0; i < 100 && server.Requests() - requests < entries; i++) {
+    CondWait::SleepMs(50);
+  }
+
+  CondWait::SleepMs(wait);
+
+  printf("cache verification: %i requests, %i kB in the background, %i updates\n",
+         server.Requests() - requests, (int)((server.Bytes() - bytes) / 1024), cached.m_triggers);
+
+  // a change notification without a change
+  requests = server.Requests();
+  server.Notify(XVDR_STATUS_CHANNELCHANGE);
+
+  for(int i = 0; i < 100 && server.Requests() - requests < entries; i++) {
+    CondWait::SleepMs(50);
+  }
+
+  CondWait::SleepMs(wait);
+  printf("spurious change notification: %i updates\n", cached.m_triggers);
+
+  // a real change
+  int triggers = cached.m_triggers;
+  server.SetChannels(channels + 1);
+  server.Notify(XVDR_STATUS_CHANNELCHANGE);
+
+  for(int i = 0; i < 100 && cached.m_triggers == triggers; i++) {
+    CondWait::SleepMs(50);
+  }
+
+  printf("channel added: %i updates\n", cached.m_triggers - triggers);
+
+  remove(filename);
+
+  if(cached.m_triggers - triggers != 1) {
+    printf("channel cache: FAILED\n");
+    return 1;
+  }
+
+  // timers are read on every update, without status messages from the server
+  server.SetTimers(50);
+  requests = server.Requests();
+
+  for(int i = 0; i < 10; i++) {
+    if(!client.LoadTimers() || client.m_timers != 50) {
+      printf("timers: FAILED\n");
+      return 1;
+    }
+  }
+
+  printf("10 timer updates without status messages: %i requests\n", server.Requests() - requests);
+
+  // and from the cache with status messages
+  requests = server.Requests();
+
+  for(int i = 0; i < 10; i++) {
+    if(!cached.LoadTimers() || cached.m_timers != 50) {
+      printf("timers: FAILED\n");
+      return 1;
+    }
+  }
+
+  printf("10 timer updates with status messages: %i requests\n", server.Requests() - requests);
+
+  // a burst of notifications without a change
+  requests = server.Requests();
+  triggers = cached.m_timertriggers;
+
+  for(int i = 0; i < 10; i++) {
+    server.Notify(XVDR_STATUS_TIMERCHANGE);
+  }
+
+  CondWait::SleepMs(1000 + 2 * rtt);
+
+  printf("10 timer notifications, no change: %i requests, %i updates\n",
+         server.Requests() - requests, cached.m_timertriggers - triggers);
+
+  // and with a change
+  requests = server.Requests();
+  triggers = cached.m_timertriggers;
+  server.SetTimers(51);
+
+  for(int i = 0; i < 10; i++) {
+    server.Notify(XVDR_STATUS_TIMERCHANGE);
+  }
+
+  CondWait::SleepMs(1000 + 2 * rtt);
+
+  if(cached.m_timertriggers - triggers != 1 || !cached.LoadTimers() || cached.m_timers != 51) {
+    printf("timer cache: FAILED\n");
+    return 1;
+  }
+
+  printf("10 timer notifications, timer added: %i requests, %i updates\n",
+         server.Requests() - requests, cached.m_timertriggers - triggers);
+
+  // a storm of notifications (recordings starting at prime time, a channel scan)
+  int delays[] = { 0, 500 };
+
+  for(unsigned int d = 0; d < sizeof(delays) / sizeof(delays[0]); d++) {
+    uint64_t notifications = 0;
+    uint64_t updates = 0;
+    uint64_t n = 0;
+    uint64_t u = 0;
+
+    WaitIdle(server);
+    cached.SetUpdateDelay(delays[d]);
+    cached.GetUpdateStats(&notifications, &updates);
+    requests = server.Requests();
+
+    for(int i = 0; i < 20; i++) {
+      server.Notify(XVDR_STATUS_TIMERCHANGE);
+      server.Notify(XVDR_STATUS_CHANNELCHANGE);
+      server.Notify(XVDR_STATUS_RECORDINGSCHANGE);
+      CondWait::SleepMs(20);
+    }
+
+    WaitIdle(server);
+    cached.GetUpdateStats(&n, &u);
+
+    printf("%i notifications in 400 ms, %3i ms window: %i updates, %i requests\n",
+           (int)(n - notifications), delays[d], (int)(u - updates), server.Requests() - requests);
+  }
+
+  return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "consoleclient.h"
+#include "standinserver.h"
+
+using namespace XVDR;
+
+// a client that gets stuck in the first batch of channels if asked to
+class StallClient : public ConsoleClient {
+public:
+
+  StallClient() : m_items(0), m_stall(false) {
+  }
+
+  void TransferChannelEntries(const std::vector<const Channel*>& channels) {
+    m_items += channels.size();
+
+    if(m_stall) {
+      m_stall = false;
+      m_stalled.Signal();
+      m_release.Wait(10000);
+    }
+  }
+
+  int m_items;
+  bool m_stall;
+  CondWait m_stalled;
+  CondWait m_release;
+};
+
+// fetches the channel list in the background
+class ListThread : public Thread {
+public:
+
+  ListThread(StallClient* client) : m_client(client), m_result(false) {
+  }
+
+  StallClient* m_client;
+  bool m_result;
+
+protected:
+
+  void Action() {
+    m_result = m_client->GetChannelsList(false);
+  }
+};
+
+int main(int argc, char* argv[]) {
+  int rtt = 20;
+  int channels = 100000;
+
+  if(argc >= 2) {
+    rtt = atoi(argv[1]);
+  }
+  if(argc >= 3) {
+    channels = atoi(argv[2]);
+  }
+
+  StandInServer server(0, rtt);
+  server.SetChannels(channels);
+
+  if(!server.Listen()) {
+    printf("unable to start the stand-in server\n");
+    return 1;
+  }
+
+  StallClient client;
+
+  if(!client.Open("127.0.0.1", "liststall")) {
+    return 1;
+  }
+
+  client.m_stall = true;
+
+  ListThread list(&client);
+  list.Start();
+
+  if(!client.m_stalled.Wait(10000)) {
+    printf("stalled decoder: FAILED\n");
+    return 1;
+  }
+
+  // the rest of the list arrives while the decoder is stuck,
+  // the response to the next request follows it
+  TimeMs t;
+  bool answered = client.SyncClock();
+  int elapsed = (int)t.Elapsed();
+
+  client.m_release.Signal();
+
+  while(list.Active()) {
+    CondWait::SleepMs(10);
+  }
+
+  printf("second request answered after %i ms while the decoder stalled\n", elapsed);
+
+  if(!answered || elapsed > 1000) {
+    printf("second request: FAILED\n");
+    return 1;
+  }
+
+  // the parts received meanwhile were kept for the decoder
+  printf("channel list: %i channels\n", client.m_items);
+
+  if(!list.m_result || client.m_items != channels) {
+    printf("channel list: FAILED\n");
+    return 1;
+  }
+
+  return 0;
+}
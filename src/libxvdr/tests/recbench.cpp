@@ -0,0 +1,401 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "consoleclient.h"
+#include "standinserver.h"
+
+using namespace XVDR;
+
+// read the whole recording, returns the throughput in MB/s (< 0 on errors)
+static double ReadRecording(int prefetch, uint64_t size, int stripes = 1) {
+  ConsoleClient client;
+
+  if(!client.Open("127.0.0.1", "recbench")) {
+    return -1;
+  }
+
+  client.SetRecordingPrefetch(prefetch);
+  client.SetRecordingStripes(stripes);
+
+  if(!client.OpenRecording("recbench")) {
+    return -1;
+  }
+
+  static unsigned char buffer[32 * 1024];
+  uint64_t position = 0;
+  TimeMs t;
+
+  while(position < size) {
+    int length = client.ReadRecording(buffer, sizeof(buffer));
+
+    if(length <= 0) {
+      return -1;
+    }
+
+    for(int i = 0; i < length; i++) {
+      if(buffer[i] != StandInServer::Pattern(position + i)) {
+        client.Log(FAILURE, "data mismatch at position %llu", (unsigned long long)(position + i));
+        return -1;
+      }
+    }
+
+    position += length;
+  }
+
+  uint64_t elapsed = t.Elapsed();
+
+  client.CloseRecording();
+  client.Close();
+
+  return elapsed ? ((double)size / (1024 * 1024)) * 1000 / elapsed : 0;
+}
+
+// skip back and replay a part of the recording, returns the time spent replaying in ms
+static int Scrub(size_t cachesize, uint64_t* hits, uint64_t* misses) {
+  ConsoleClient client;
+
+  if(!client.Open("127.0.0.1", "recbench")) {
+    return -1;
+  }
+
+  client.SetRecordingCache(cachesize);
+
+  if(!client.OpenRecording("recbench")) {
+    return -1;
+  }
+
+  static unsigned char buffer[32 * 1024];
+  const int chunk = 1024 * 1024;
+
+  // play the first 4 MB
+  for(int i = 0; i < 4 * chunk / (int)sizeof(buffer); i++) {
+    if(client.ReadRecording(buffer, sizeof(buffer)) <= 0) {
+      return -1;
+    }
+  }
+
+  TimeMs t;
+
+  // skip back a megabyte and replay it, 10 times
+  for(int n = 0; n < 10; n++) {
+    client.SeekRecording(-chunk, SEEK_CUR);
+
+    for(int i = 0; i < chunk / (int)sizeof(buffer); i++) {
+      if(client.ReadRecording(buffer, sizeof(buffer)) <= 0) {
+        return -1;
+      }
+    }
+  }
+
+  int elapsed = (int)t.Elapsed();
+
+  client.GetRecordingCacheStats(hits, misses);
+  client.CloseRecording();
+  client.Close();
+
+  return elapsed;
+}
+
+// seek to every second of the recording twice, returns the requests of both passes
+static bool SeekTime(StandInServer& server, int* first, int* second) {
+  ConsoleClient client;
+
+  if(!client.Open("127.0.0.1", "recbench") || !client.OpenRecording("recbench")) {
+    return false;
+  }
+
+  int seconds = client.RecordingFrames() / 25;
+
+  for(int pass = 0; pass < 2; pass++) {
+    int requests = server.Requests();
+
+    for(int s = 0; s < seconds; s++) {
+      long long position = client.SeekRecordingTime(s * 1000 + 500);
+
+      // must land on the I-frame in front of the requested frame
+      uint32_t frame = (s * 1000 + 500) * 25 / 1000;
+
+      if(position != (long long)(frame / StandInServer::GOP * StandInServer::GOP) * StandInServer::FrameSize) {
+        return false;
+      }
+    }
+
+    *(pass ? second : first) = server.Requests() - requests;
+  }
+
+  client.CloseRecording();
+  client.Close();
+
+  return true;
+}
+
+// scan through the recording at speed, returns the number of pictures (-1 on error)
+static int TrickPlay(int speed, uint64_t* bytes, int* elapsed) {
+  ConsoleClient client;
+
+  if(!client.Open("127.0.0.1", "recbench") || !client.OpenRecording("recbench")) {
+    return -1;
+  }
+
+  // rewind starts at the end
+  if(speed < 0) {
+    client.SeekRecordingFrame(client.RecordingFrames() - 1);
+  }
+
+  if(!client.SetRecordingSpeed(speed)) {
+    return -1;
+  }
+
+  static unsigned char buffer[StandInServer::FrameSize];
+  int pictures = 0;
+  int length = 0;
+  *bytes = 0;
+
+  TimeMs t;
+
+  while((length = client.ReadRecording(buffer, sizeof(buffer))) > 0) {
+    uint64_t position = client.RecordingPosition();
+
+    for(int i = 0; i < length; i++) {
+      if(buffer[i] != StandInServer::Pattern(position + i)) {
+        return -1;
+      }
+    }
+
+    *bytes += length;
+    pictures++;
+  }
+
+  *elapsed = (int)t.Elapsed();
+
+  client.CloseRecording();
+  client.Close();
+
+  return (length < 0) ? -1 : pictures;
+}
+
+// wait until the client stopped talking to the server
+static void WaitIdle(StandInServer& server) {
+  int requests = -1;
+
+  while(requests != server.Requests()) {
+    requests = server.Requests();
+    CondWait::SleepMs(500);
+  }
+}
+
+// query and update the resume points of a library view
+static bool Library(StandInServer& server, int recordings) {
+  ConsoleClient client;
+
+  if(!client.Open("127.0.0.1", "recbench") || !client.GetRecordingsList()) {
+    return false;
+  }
+
+  WaitIdle(server);
+
+  char id[16];
+  int requests = server.Requests();
+  TimeMs t;
+
+  for(int i = 0; i < recordings; i++) {
+    sprintf(id, "rec%i", i);
+    client.GetRecordingLastPosition(id);
+  }
+
+  printf("library: %i resume points read in %i ms, %i requests\n", recordings, (int)t.Elapsed(), server.Requests() - requests);
+
+  requests = server.Requests();
+  t.Set();
+
+  for(int i = 0; i < recordings; i++) {
+    sprintf(id, "rec%i", i);
+    client.SetRecordingLastPosition(id, i);
+    client.SetRecordingPlayCount(id, 1);
+  }
+
+  printf("library: %i resume points and play counts set in %i ms\n", recordings, (int)t.Elapsed());
+
+  // changes are collected for 2 seconds
+  CondWait::SleepMs(2500);
+  WaitIdle(server);
+  printf("library: %i requests written back in the background\n", server.Requests() - requests);
+
+  client.Close();
+  return true;
+}
+
+// download the whole recording, returns the throughput in MB/s (< 0 on errors)
+static double Download(uint64_t size, int sessions) {
+  ConsoleClient client;
+  const char* filename = "recbench.download";
+
+  if(!client.Open("127.0.0.1", "recbench")) {
+    return -1;
+  }
+
+  TimeMs t;
+  bool rc = client.DownloadRecording("recbench", filename, sessions);
+  uint64_t elapsed = t.Elapsed();
+
+  FILE* file = fopen(filename, "rb");
+  uint64_t downloaded = 0;
+  int c = 0;
+
+  while(file != NULL && (c = fgetc(file)) != EOF) {
+    if((uint8_t)c != StandInServer::Pattern(downloaded)) {
+      rc = false;
+      break;
+    }
+    downloaded++;
+  }
+
+  if(file != NULL) {
+    fclose(file);
+  }
+
+  remove(filename);
+
+  if(!rc || downloaded != size) {
+    return -1;
+  }
+
+  return elapsed ? ((double)size / (1024 * 1024)) * 1000 / elapsed : 0;
+}
+
+int main(int argc, char* argv[]) {
+  int rtt = 20;
+  int megabytes = 16;
+
+  if(argc >= 2) {
+    rtt = atoi(argv[1]);
+  }
+  if(argc >= 3) {
+    megabytes = atoi(argv[2]);
+  }
+
+  uint64_t size = (uint64_t)megabytes * 1024 * 1024;
+  StandInServer server(size, rtt);
+
+  if(!server.Listen()) {
+    printf("unable to start the stand-in server\n");
+    return 1;
+  }
+
+  int windows[] = { 0, 4, 8, 16, 32 };
+
+  for(unsigned int i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+    int requests = server.Requests();
+    double mbs = ReadRecording(windows[i], size);
+
+    if(mbs < 0) {
+      printf("prefetch %2i blocks: FAILED\n", windows[i]);
+      return 1;
+    }
+
+    printf("prefetch %2i blocks: %8.2f MB/s, %i requests (rtt %i ms)\n", windows[i], mbs, server.Requests() - requests, rtt);
+  }
+
+  size_t cachesizes[] = { 512 * 1024, 16 * 1024 * 1024 };
+
+  for(unsigned int i = 0; i < sizeof(cachesizes) / sizeof(cachesizes[0]); i++) {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    int elapsed = Scrub(cachesizes[i], &hits, &misses);
+
+    if(elapsed < 0) {
+      printf("scrubbing with %5lu kB cache: FAILED\n", (unsigned long)(cachesizes[i] / 1024));
+      return 1;
+    }
+
+    printf("scrubbing with %5lu kB cache: %5i ms, %llu hits, %llu misses\n", (unsigned long)(cachesizes[i] / 1024), elapsed, (unsigned long long)hits, (unsigned long long)misses);
+  }
+
+  int first = 0;
+  int second = 0;
+
+  if(!SeekTime(server, &first, &second)) {
+    printf("time based seeks: FAILED\n");
+    return 1;
+  }
+
+  printf("time based seeks: %i requests first pass, %i requests second pass\n", first, second);
+
+  int speeds[] = { 8, 16, 32, -8 };
+
+  for(unsigned int i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+    uint64_t bytes = 0;
+    int elapsed = 0;
+    int pictures = TrickPlay(speeds[i], &bytes, &elapsed);
+
+    if(pictures < 0) {
+      printf("trick-play %3ix: FAILED\n", speeds[i]);
+      return 1;
+    }
+
+    printf("trick-play %3ix: %4i I-frames in %5i ms, %5.2f%% of the recording transferred\n", speeds[i], pictures, elapsed, (double)bytes * 100 / size);
+  }
+
+  server.SetRecordings(500);
+
+  if(!Library(server, 500)) {
+    printf("library: FAILED\n");
+    return 1;
+  }
+
+  // every session serves a block in 2 ms (~32 MB/s per connection)
+  server.SetBlockCost(2);
+
+  int stripes[] = { 1, 2, 4 };
+
+  for(unsigned int i = 0; i < sizeof(stripes) / sizeof(stripes[0]); i++) {
+    double mbs = ReadRecording(32, size, stripes[i]);
+
+    if(mbs < 0) {
+      printf("%i sessions: FAILED\n", stripes[i]);
+      return 1;
+    }
+
+    printf("%i sessions, prefetch 32 blocks: %8.2f MB/s (2 ms per block and session)\n", stripes[i], mbs);
+  }
+
+  // a download opens its own sessions, the time includes logging in
+  int downloads[] = { 1, 4 };
+
+  for(unsigned int i = 0; i < sizeof(downloads) / sizeof(downloads[0]); i++) {
+    double mbs = Download(size, downloads[i]);
+
+    if(mbs < 0) {
+      printf("download: FAILED\n");
+      return 1;
+    }
+
+    printf("download with %i sessions: %8.2f MB/s (2 ms per block and session)\n", downloads[i], mbs);
+  }
+
+  return 0;
+}
@@ -0,0 +1,728 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "xvdr/command.h"
+#include "xvdr/dataset.h"
+#include "standinserver.h"
+
+using namespace XVDR;
+
+class StandInServer::Session : public Thread {
+public:
+
+  Session(StandInServer* server, int fd) : m_server(server), m_fd(fd), m_sender(this), m_streamer(this), m_busy(0), m_closed(false), m_status(false) {
+  }
+
+  ~Session() {
+    Cancel(3);
+    m_streamer.Stop();
+    m_sender.Stop();
+    close(m_fd);
+
+    while(!m_responses.empty()) {
+      delete m_responses.front().packet;
+      m_responses.pop_front();
+    }
+  }
+
+  void Run() {
+    Start();
+    m_sender.Start();
+  }
+
+  // send a status message (if the session asked for them)
+  void Push(MsgPacket* packet) {
+    Queue(packet, true);
+  }
+
+protected:
+
+  // receive requests, the sender thread delivers the responses
+  void Action() {
+    while(Running()) {
+      bool closed = false;
+      MsgPacket* request = MsgPacket::read(m_fd, closed, 100);
+
+      if(closed) {
+        MutexLock lock(&m_lock);
+        m_closed = true;
+        break;
+      }
+
+      if(request == NULL) {
+        continue;
+      }
+
+      if(request->getMsgID() == XVDR_ENABLESTATUSINTERFACE) {
+        MutexLock lock(&m_lock);
+        m_status = request->get_U8();
+        request->rewind();
+      }
+
+      Response r;
+      r.due = TimeMs::Now() + m_server->m_rtt;
+
+      // blocks are served one after another
+      if(request->getMsgID() == XVDR_RECSTREAM_GETBLOCK) {
+        uint64_t now = TimeMs::Now();
+        m_busy = ((m_busy > now) ? m_busy : now) + m_server->BlockCost();
+
+        if(m_busy + m_server->m_rtt > r.due) {
+          r.due = m_busy + m_server->m_rtt;
+        }
+      }
+
+      uint16_t msgid = request->getMsgID();
+
+      if(msgid == XVDR_CHANNELSTREAM_OPEN || msgid == XVDR_CHANNELSTREAM_CLOSE) {
+        m_streamer.Stop();
+      }
+
+      r.packet = m_server->Process(request);
+      delete request;
+
+      if(r.packet == NULL) {
+        continue;
+      }
+
+      m_lock.Lock();
+      m_responses.push_back(r);
+      m_cond.Signal();
+      m_lock.Unlock();
+
+      // the live stream follows the response of a channel switch
+      if(msgid == XVDR_CHANNELSTREAM_OPEN) {
+        m_streamer.Start();
+      }
+    }
+  }
+
+private:
+
+  struct Response {
+    uint64_t due;
+    MsgPacket* packet;
+  };
+
+  void Queue(MsgPacket* packet, bool status = false) {
+    Response r;
+    r.due = TimeMs::Now();
+    r.packet = packet;
+
+    MutexLock lock(&m_lock);
+
+    if(m_closed || (status && !m_status)) {
+      delete packet;
+      return;
+    }
+
+    m_responses.push_back(r);
+    m_cond.Signal();
+  }
+
+  // live stream of a single video stream, a frame every FrameTime ms
+  class Streamer : public Thread {
+  public:
+
+    Streamer(Session* session) : m_session(session) {
+    }
+
+    void Stop() {
+      Cancel(3);
+    }
+
+  protected:
+
+    void Action() {
+      // let the client finish the channel switch
+      CondWait::SleepMs(m_session->m_server->m_rtt + 5 * FrameTime);
+
+      MsgPacket* streams = new MsgPacket(XVDR_STREAM_CHANGE, XVDR_CHANNEL_STREAM);
+      streams->put_U32(1);
+      streams->put_String("MPEG2VIDEO");
+      streams->put_U32(1); // fps scale
+      streams->put_U32(25); // fps rate
+      streams->put_U32(576);
+      streams->put_U32(720);
+      streams->put_S64(17777);
+      m_session->Queue(streams);
+
+      uint64_t start = TimeMs::Now();
+
+      for(uint32_t frame = 0; Running(); frame++) {
+        uint64_t due = start + (uint64_t)frame * FrameTime;
+        uint64_t now = TimeMs::Now();
+
+        if(due > now) {
+          CondWait::SleepMs((int)(due - now));
+        }
+
+        // picture header, the coding type in bits 3-5 of the second byte after the temporal reference
+        uint8_t picture[] = { 0x00, 0x00, 0x01, 0x00, 0x00, (uint8_t)(((frame % GOP == 0) ? 1 : 2) << 3) };
+        int64_t pts = (int64_t)frame * FrameTime * 1000;
+
+        MsgPacket* packet = new MsgPacket(XVDR_STREAM_MUXPKT, XVDR_CHANNEL_STREAM);
+        packet->put_U16(1);
+        packet->put_S64(pts);
+        packet->put_S64(pts);
+        packet->put_U32(FrameTime * 1000);
+        packet->put_U32(sizeof(picture));
+        packet->put_Blob(picture, sizeof(picture));
+        m_session->Queue(packet);
+      }
+    }
+
+  private:
+
+    Session* m_session;
+  };
+
+  class Sender : public Thread {
+  public:
+
+    Sender(Session* session) : m_session(session) {
+    }
+
+    void Stop() {
+      Cancel(3);
+    }
+
+  protected:
+
+    void Action() {
+      while(Running()) {
+        m_session->m_lock.Lock();
+
+        if(m_session->m_responses.empty()) {
+          m_session->m_lock.Unlock();
+          m_session->m_cond.Wait(100);
+          continue;
+        }
+
+        Response r = m_session->m_responses.front();
+        m_session->m_responses.pop_front();
+        m_session->m_lock.Unlock();
+
+        uint64_t now = TimeMs::Now();
+
+        if(r.due > now) {
+          CondWait::SleepMs((int)(r.due - now));
+        }
+
+        Write(r.packet);
+        delete r.packet;
+      }
+    }
+
+    // send in slices of 10 ms if the bandwidth is limited
+    void Write(MsgPacket* packet) {
+      int bandwidth = m_session->m_server->Bandwidth();
+
+      if(bandwidth == 0) {
+        packet->write(m_session->m_fd, 3000);
+        return;
+      }
+
+      packet->freeze();
+
+      uint8_t* data = packet->getPacket();
+      uint32_t length = packet->getPacketLength();
+      uint32_t slice = bandwidth * 1024 / 100;
+
+      for(uint32_t pos = 0; pos < length;) {
+        uint32_t size = (length - pos < slice) ? length - pos : slice;
+        ssize_t rc = ::send(m_session->m_fd, data + pos, size, 0);
+
+        if(rc <= 0) {
+          return;
+        }
+
+        pos += rc;
+
+        if(rc * 10 >= slice) {
+          CondWait::SleepMs(rc * 10 / slice);
+        }
+      }
+    }
+
+  private:
+
+    Session* m_session;
+  };
+
+  StandInServer* m_server;
+  int m_fd;
+  Sender m_sender;
+  Streamer m_streamer;
+  Mutex m_lock;
+  CondWait m_cond;
+  std::deque<Response> m_responses;
+  uint64_t m_busy;
+  bool m_closed;
+  bool m_status;
+};
+
+StandInServer::StandInServer(uint64_t recordingsize, int rtt_ms) : m_fd(-1), m_recordingsize(recordingsize), m_rtt(rtt_ms), m_blockcost(0), m_requests(0), m_recordings(0), m_channels(0), m_timers(0), m_bandwidth(0), m_guiderevision(0), m_compression(0), m_broken(false), m_clockoffset(0), m_bytes(0) {
+}
+
+StandInServer::~StandInServer() {
+  Cancel(3);
+
+  for(std::vector<Session*>::iterator i = m_sessions.begin(); i != m_sessions.end(); i++) {
+    delete *i;
+  }
+
+  if(m_fd != -1) {
+    close(m_fd);
+  }
+}
+
+bool StandInServer::Listen(int port) {
+  m_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  if(m_fd == -1) {
+    return false;
+  }
+
+  int one = 1;
+  setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if(bind(m_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(m_fd, 8) == -1) {
+    close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  return Start();
+}
+
+int StandInServer::Requests() {
+  MutexLock lock(&m_lock);
+  return m_requests;
+}
+
+void StandInServer::SetBlockCost(int ms) {
+  MutexLock lock(&m_lock);
+  m_blockcost = ms;
+}
+
+int StandInServer::BlockCost() {
+  MutexLock lock(&m_lock);
+  return m_blockcost;
+}
+
+void StandInServer::SetRecordings(int count) {
+  MutexLock lock(&m_lock);
+  m_recordings = count;
+}
+
+void StandInServer::SetChannels(int count) {
+  MutexLock lock(&m_lock);
+  m_channels = count;
+}
+
+void StandInServer::SetTimers(int count) {
+  MutexLock lock(&m_lock);
+  m_timers = count;
+}
+
+void StandInServer::SetBandwidth(int kbytes_per_s) {
+  MutexLock lock(&m_lock);
+  m_bandwidth = kbytes_per_s;
+}
+
+int StandInServer::Bandwidth() {
+  MutexLock lock(&m_lock);
+  return m_bandwidth;
+}
+
+void StandInServer::SetGuideRevision(int revision) {
+  MutexLock lock(&m_lock);
+  m_guiderevision = revision;
+}
+
+void StandInServer::SetCompression(int level) {
+  MutexLock lock(&m_lock);
+  m_compression = level;
+}
+
+void StandInServer::SetBrokenResponses(bool enable) {
+  MutexLock lock(&m_lock);
+  m_broken = enable;
+}
+
+void StandInServer::SetClockOffset(int ms) {
+  MutexLock lock(&m_lock);
+  m_clockoffset = ms;
+}
+
+uint32_t StandInServer::ServerTime() {
+  MutexLock lock(&m_lock);
+  return (uint32_t)((TimeMs::Now() + m_clockoffset) / 1000);
+}
+
+uint64_t StandInServer::Bytes() {
+  MutexLock lock(&m_lock);
+  return m_bytes;
+}
+
+void StandInServer::Notify(uint16_t msgid) {
+  MutexLock lock(&m_lock);
+
+  for(std::vector<Session*>::iterator i = m_sessions.begin(); i != m_sessions.end(); i++) {
+    (*i)->Push(new MsgPacket(msgid, XVDR_CHANNEL_STATUS));
+  }
+}
+
+int StandInServer::Sessions() {
+  MutexLock lock(&m_lock);
+  return (int)m_sessions.size();
+}
+
+void StandInServer::Action() {
+  while(Running()) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(m_fd, &fds);
+
+    struct timeval tv = { 0, 100000 };
+
+    if(select(m_fd + 1, &fds, NULL, NULL, &tv) <= 0) {
+      continue;
+    }
+
+    int fd = accept(m_fd, NULL, NULL);
+
+    if(fd == -1) {
+      continue;
+    }
+
+    Session* session = new Session(this, fd);
+
+    m_lock.Lock();
+    m_sessions.push_back(session);
+    m_lock.Unlock();
+
+    session->Run();
+  }
+}
+
+MsgPacket* StandInServer::Process(MsgPacket* request) {
+  {
+    MutexLock lock(&m_lock);
+    m_requests++;
+    m_bytes += request->getPacketLength();
+  }
+
+  MsgPacket* resp = new MsgPacket(request->getMsgID(), XVDR_CHANNEL_REQUEST_RESPONSE, request->getUID());
+  uint32_t frames = (uint32_t)(m_recordingsize / FrameSize);
+
+  switch(request->getMsgID()) {
+    case XVDR_LOGIN:
+      resp->setProtocolVersion(XVDRPROTOCOLVERSION);
+      resp->put_U32(time(NULL));
+      resp->put_S32(0);
+      resp->put_String("StandInServer");
+      resp->put_String("0.0.0");
+      break;
+
+    case XVDR_ENABLESTATUSINTERFACE:
+      resp->put_U32(XVDR_RET_OK);
+      break;
+
+    case XVDR_GETTIME:
+      resp->put_U32(ServerTime());
+      resp->put_S32(0);
+      break;
+
+    case XVDR_CHANNELSTREAM_OPEN:
+    case XVDR_CHANNELSTREAM_CLOSE:
+      resp->put_U32(XVDR_RET_OK);
+      break;
+
+    case XVDR_RECSTREAM_OPEN:
+      resp->put_U32(XVDR_RET_OK);
+      resp->put_U32(frames);
+      resp->put_U64(m_recordingsize);
+      break;
+
+    case XVDR_RECSTREAM_UPDATE:
+      resp->put_U32(frames);
+      resp->put_U64(m_recordingsize);
+      break;
+
+    case XVDR_RECSTREAM_POSTOFRAME: {
+      uint64_t position = request->get_U64();
+      resp->put_U32((uint32_t)(position / FrameSize));
+      break;
+    }
+
+    case XVDR_RECSTREAM_FRAMETOPOS: {
+      uint32_t frame = request->get_U32();
+      resp->put_U64((uint64_t)frame * FrameSize);
+      break;
+    }
+
+    case XVDR_RECSTREAM_GETIFRAME: {
+      uint32_t frame = request->get_U32();
+      uint32_t forward = request->get_U32();
+
+      frame = (forward ? frame + GOP - 1 : frame) / GOP * GOP;
+
+      if(frame >= frames) {
+        resp->put_U32(0);
+        break;
+      }
+
+      resp->put_U64((uint64_t)frame * FrameSize);
+      resp->put_U32(frame);
+      resp->put_U32(FrameSize);
+      break;
+    }
+
+    case XVDR_RECSTREAM_CLOSE:
+      resp->put_U32(XVDR_RET_OK);
+      break;
+
+    case XVDR_RECSTREAM_GETBLOCK: {
+      uint64_t position = request->get_U64();
+      uint32_t size = request->get_U32();
+
+      if(position >= m_recordingsize) {
+        break;
+      }
+
+      if(position + size > m_recordingsize) {
+        size = (uint32_t)(m_recordingsize - position);
+      }
+
+      uint8_t* data = resp->reserve(size);
+
+      for(uint32_t i = 0; i < size; i++) {
+        data[i] = Pattern(position + i);
+      }
+      break;
+    }
+
+    case XVDR_RECORDINGS_GETCOUNT: {
+      MutexLock lock(&m_lock);
+      resp->put_U32(m_recordings);
+      break;
+    }
+
+    case XVDR_RECORDINGS_GETLIST: {
+      MutexLock lock(&m_lock);
+
+      for(int i = 0; i < m_recordings; i++) {
+        char id[16];
+        sprintf(id, "rec%i", i);
+
+        RecordingEntry rec;
+        rec.Id = id;
+        rec.Title = id;
+        rec.Plot = "a synthetic recording for benchmarks";
+        *resp << rec;
+      }
+      break;
+    }
+
+    case XVDR_RECORDINGS_GETPOSITION: {
+      MutexLock lock(&m_lock);
+      resp->put_S64(m_positions[request->get_String()]);
+      break;
+    }
+
+    case XVDR_RECORDINGS_SETPOSITION: {
+      MutexLock lock(&m_lock);
+      std::string id = request->get_String();
+      m_positions[id] = request->get_S64();
+      resp->put_U32(XVDR_RET_OK);
+      break;
+    }
+
+    case XVDR_RECORDINGS_SETPLAYCOUNT:
+      resp->put_U32(XVDR_RET_OK);
+      break;
+
+    case XVDR_CHANNELS_GETCOUNT:
+      resp->put_U32(m_channels);
+      break;
+
+    case XVDR_CHANNELS_GETCHANNELS: {
+      bool radio = request->get_U32();
+
+      for(int n = 1; n <= m_channels; n++) {
+        char name[64];
+        sprintf(name, "%s channel %i", radio ? "Radio" : "TV", n);
+
+        resp->put_U32(n);
+        resp->put_String(name);
+        resp->put_U32(n);
+        resp->put_U32(0);
+        resp->put_String("http://127.0.0.1/logos/standin.png");
+        resp->put_String("S19.2E-1-1079-28006");
+      }
+      break;
+    }
+
+    case XVDR_TIMER_GETCOUNT:
+      resp->put_U32(m_timers);
+      break;
+
+    // a daily timer on every channel
+    case XVDR_TIMER_GETLIST: {
+      resp->put_U32(m_timers);
+
+      for(int n = 1; n <= m_timers; n++) {
+        char title[64];
+        sprintf(title, "Timers~Timer %i", n);
+
+        resp->put_U32(n);
+        resp->put_U32(1);
+        resp->put_U32(50);
+        resp->put_U32(99);
+        resp->put_U32(n);
+        resp->put_U32(1380000000 + n * EventLength);
+        resp->put_U32(1380000000 + (n + 1) * EventLength);
+        resp->put_U32(0);
+        resp->put_U32(0x7f);
+        resp->put_String(title);
+      }
+      break;
+    }
+
+    // a group of up to 100 channels each
+    case XVDR_CHANNELGROUP_GETCOUNT:
+      resp->put_U32((m_channels + 99) / 100);
+      break;
+
+    case XVDR_CHANNELGROUP_LIST: {
+      bool radio = request->get_U8();
+
+      for(int n = 1; n <= (m_channels + 99) / 100; n++) {
+        char name[64];
+        sprintf(name, "Group %i", n);
+
+        resp->put_String(name);
+        resp->put_U8(radio);
+      }
+      break;
+    }
+
+    case XVDR_CHANNELGROUP_MEMBERS: {
+      int group = 0;
+      sscanf(request->get_String(), "Group %i", &group);
+
+      for(int n = (group - 1) * 100 + 1; group > 0 && n <= group * 100 && n <= m_channels; n++) {
+        resp->put_U32(n);
+        resp->put_U32(n);
+      }
+      break;
+    }
+
+    case XVDR_EPG_GETFORCHANNEL: {
+      uint32_t channeluid = request->get_U32();
+      uint32_t start = request->get_U32();
+      uint32_t end = start + request->get_U32();
+
+      for(uint32_t t = start - start % EventLength; t < end; t += EventLength) {
+        *resp << GuideEvent(channeluid, t);
+      }
+      break;
+    }
+
+    case XVDR_RECORDINGS_GETMARKS:
+      resp->put_U32(XVDR_RET_OK);
+      resp->put_U64(250000);
+      break;
+
+    default:
+      resp->put_U32(XVDR_RET_NOTSUPPORTED);
+      break;
+  }
+
+  MutexLock lock(&m_lock);
+
+  if(resp->getPayloadLength() > 64 * 1024) {
+    if(m_compression > 0) {
+      resp->compress(m_compression);
+    }
+
+    // the checksum is taken before
+    if(m_broken) {
+      resp->freeze();
+      resp->getPayload()[resp->getPayloadLength() / 2] ^= 0xFF;
+    }
+  }
+
+  m_bytes += resp->getPacketLength();
+
+  return resp;
+}
+
+EpgItem StandInServer::GuideEvent(uint32_t channeluid, uint32_t t) {
+  char title[64];
+  uint32_t id = t / EventLength;
+  int revision = 0;
+
+  {
+    MutexLock lock(&m_lock);
+    revision = (id % 50 == 0) ? m_guiderevision : 0;
+  }
+
+  if(revision > 0) {
+    sprintf(title, "Event %u on channel %u (revision %i)", id, channeluid, revision);
+  }
+  else {
+    sprintf(title, "Event %u on channel %u", id, channeluid);
+  }
+
+  EpgItem item;
+  item.BroadcastID = id;
+  item.StartTime = t;
+  item.EndTime = t + EventLength;
+  item.Title = title;
+  item.PlotOutline = "A synthetic event for benchmarks";
+  item.Plot = "Every channel of the stand-in server has a guide made of half-hour events. "
+              "This text is about as long as the description of a real broadcast, "
+              "so the amount of data transferred matches a real guide.";
+
+  return item;
+}
@@ -0,0 +1,169 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "xvdr/dataset.h"
+#include "xvdr/msgpacket.h"
+#include "xvdr/thread.h"
+
+/**
+ * Minimal XVDR server for benchmarks.
+ *
+ * Answers login and recording stream requests for a single synthetic
+ * recording made of fixed size frames with an I-frame every GOP frames.
+ * The recordings list holds a configurable number of entries named
+ * "rec0", "rec1", ... with resume points but without cut marks. Every
+ * channel has a guide of half-hour events.
+ * Opening a channel starts a live stream of a single MPEG-2 video
+ * stream, one small frame every FrameTime ms.
+ * Every response is delayed by the configured round trip time,
+ * pipelined requests are delayed independently like on a real link.
+ * Optionally responses are sent at a limited bandwidth.
+ */
+class StandInServer : public XVDR::Thread {
+public:
+
+  StandInServer(uint64_t recordingsize, int rtt_ms);
+  ~StandInServer();
+
+  bool Listen(int port = 34891);
+
+  int Requests();
+
+  /**
+   * Time a session needs to serve a block (per connection bottleneck).
+   */
+  void SetBlockCost(int ms);
+
+  /**
+   * Number of entries in the recordings list.
+   */
+  void SetRecordings(int count);
+
+  /**
+   * Number of entries in the channel list.
+   */
+  void SetChannels(int count);
+
+  /**
+   * Number of timers.
+   */
+  void SetTimers(int count);
+
+  /**
+   * Limit the bandwidth of each session (0 = unlimited).
+   */
+  void SetBandwidth(int kbytes_per_s);
+
+  /**
+   * Change every 50th event of the guide to the given revision.
+   */
+  void SetGuideRevision(int revision);
+
+  /**
+   * Compress responses larger than 64 kB (0 = off).
+   */
+  void SetCompression(int level);
+
+  /**
+   * Damage the payload of responses larger than 64 kB.
+   */
+  void SetBrokenResponses(bool enable);
+
+  /**
+   * Let the server clock run ahead of the local clock (ms).
+   */
+  void SetClockOffset(int ms);
+
+  /**
+   * Bytes of all requests and responses so far.
+   */
+  uint64_t Bytes();
+
+  /**
+   * Event of a channel's guide starting at t.
+   */
+  XVDR::EpgItem GuideEvent(uint32_t channeluid, uint32_t t);
+
+  /**
+   * Send a status message (XVDR_STATUS_...) to all sessions with the
+   * status interface enabled.
+   */
+  void Notify(uint16_t msgid);
+
+  /**
+   * Number of connections accepted so far.
+   */
+  int Sessions();
+
+  /**
+   * Expected content of the recording at position.
+   */
+  static uint8_t Pattern(uint64_t position) {
+    return (uint8_t)(position % 251);
+  }
+
+  enum { FrameSize = 20000, GOP = 12, EventLength = 1800, FrameTime = 40 };
+
+protected:
+
+  void Action();
+
+private:
+
+  class Session;
+
+  friend class Session;
+
+  MsgPacket* Process(MsgPacket* request);
+
+  int BlockCost();
+
+  int Bandwidth();
+
+  uint32_t ServerTime();
+
+  int m_fd;
+  uint64_t m_recordingsize;
+  int m_rtt;
+  int m_blockcost;
+  int m_requests;
+  int m_recordings;
+  int m_channels;
+  int m_timers;
+  int m_bandwidth;
+  int m_guiderevision;
+  int m_compression;
+  bool m_broken;
+  int m_clockoffset;
+  uint64_t m_bytes;
+  std::map<std::string, int64_t> m_positions;
+  XVDR::Mutex m_lock;
+  std::vector<Session*> m_sessions;
+};
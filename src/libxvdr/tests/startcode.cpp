@@ -0,0 +1,109 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2013 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "xvdr/frameparser.h"
+#include "xvdr/thread.h"
+
+using namespace XVDR;
+
+// synthetic H264 elementary stream: one slice every 'gap' bytes
+static void CreateStream(std::vector<uint8_t>& data, int size, int gap) {
+  data.resize(size);
+
+  for(int i = 0; i < size; i++) {
+    data[i] = (uint8_t)(rand() | 0x80);
+  }
+
+  for(int i = 0; i + 8 < size; i += gap) {
+    data[i] = 0;
+    data[i + 1] = 0;
+    data[i + 2] = 1;
+    bool idr = ((i / gap) % 12 == 0);
+    data[i + 3] = idr ? 0x65 : 0x41;
+    data[i + 4] = idr ? 0x88 : 0xC0; // first_mb = 0, slice_type = 7 (I) / 0 (P)
+  }
+}
+
+static int Scan(const std::vector<uint8_t>& data, bool scalar) {
+  const uint8_t* p = &data[0];
+  const uint8_t* end = p + data.size();
+  int count = 0;
+
+  while((p = (scalar ? FrameParser::FindStartCodeScalar(p, end) : FrameParser::FindStartCode(p, end))) != NULL) {
+    count++;
+  }
+
+  return count;
+}
+
+int main(int argc, char* argv[]) {
+  int rounds = 50;
+
+  if(argc >= 2) {
+    rounds = atoi(argv[1]);
+  }
+
+  std::vector<uint8_t> data;
+  CreateStream(data, 4 * 1024 * 1024, 16 * 1024);
+
+  const char* names[] = { "scalar", "simd" };
+  int found[2] = { 0, 0 };
+
+  for(int n = 0; n < 2; n++) {
+    TimeMs t;
+
+    for(int i = 0; i < rounds; i++) {
+      found[n] = Scan(data, n == 0);
+    }
+
+    uint64_t elapsed = t.Elapsed();
+    double mb = (double)data.size() * rounds / (1024 * 1024);
+
+    printf("%-8s %6d start codes, %8.1f MB/s\n", names[n], found[n], elapsed ? mb * 1000 / elapsed : 0);
+  }
+
+  if(found[0] != found[1]) {
+    printf("MISMATCH: scalar and simd scanner disagree\n");
+    return 1;
+  }
+
+  int frames[4] = { 0, 0, 0, 0 };
+  TimeMs t;
+
+  for(size_t i = 0; i + 16 * 1024 <= data.size(); i += 16 * 1024) {
+    frames[FrameParser::GetFrameType(FrameParser::CODEC_H264, &data[i], 16 * 1024)]++;
+  }
+
+  printf("classified %d I / %d P / %d B / %d unknown frames in %llu ms\n",
+         frames[FrameParser::FT_IFRAME], frames[FrameParser::FT_PFRAME],
+         frames[FrameParser::FT_BFRAME], frames[FrameParser::FT_UNKNOWN],
+         (unsigned long long)t.Elapsed());
+
+  return 0;
+}
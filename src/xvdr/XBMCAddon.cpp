@@ -51,6 +51,8 @@ CHelper_libXBMC_gui* GUI = NULL;
 CHelper_libXBMC_pvr* PVR = NULL;
 
 Demux* mDemuxer = NULL;
+Demux* mDemuxerPool = NULL;
+bool mDemuxerStale = false;
 cXBMCClient *mClient = NULL;
 XVDR::Mutex addonMutex;
 
@@ -58,6 +60,86 @@ int CurrentChannel = 0;
 
 static int priotable[] = { 0,5,10,15,20,25,30,35,40,45,50,55,60,65,70,75,80,85,90,95,99,100 };
 
+/**
+ * Stop streaming on the active demuxer and keep its logged-in session
+ * for the next live stream. Demuxers created with outdated settings are
+ * dropped instead.
+ */
+static void ReleaseDemuxer()
+{
+  if (mDemuxer == NULL)
+    return;
+
+  delete mDemuxerPool;
+  mDemuxerPool = NULL;
+
+  if (mDemuxerStale || mDemuxer->ConnectionLost() || mDemuxer->Aborting())
+  {
+    mDemuxer->Close();
+    delete mDemuxer;
+  }
+  else
+  {
+    mDemuxer->CloseChannel();
+    mDemuxerPool = mDemuxer;
+  }
+
+  mDemuxer = NULL;
+  mDemuxerStale = false;
+}
+
+static int StreamFilter()
+{
+  switch(cXBMCSettings::GetInstance().StreamFilter())
+  {
+    case 1:
+      return Demux::SF_PREFERRED_AUDIO;
+    case 2:
+      return Demux::SF_PREFERRED_AUDIO | Demux::SF_NO_SUBTITLES | Demux::SF_NO_TELETEXT;
+    default:
+      return Demux::SF_NONE;
+  }
+}
+
+static PacketBuffer* CreateTimeshiftBuffer()
+{
+  cXBMCSettings& s = cXBMCSettings::GetInstance();
+  PacketBuffer* buf = NULL;
+
+  // simple timeshift
+  if(s.TSMethod() == 0) {
+    XBMC->Log(LOG_NOTICE, "doing simple server-side timeshift");
+  }
+
+  // full-timeshift (ram)
+  else if(s.TSMethod() == 1) {
+    buf = (s.TSBufferSize() > 0) ? PacketBuffer::create(s.TSBufferSize() * 1024 * 1024) : NULL;
+    if(buf != NULL) {
+      XBMC->Log(LOG_NOTICE, "doing timeshift in memory using %f Mb RAM", s.TSBufferSize());
+    }
+  }
+
+  // full-timeshift (hdd)
+  else if(s.TSMethod() == 2) {
+    std::string tsfile = s.TSFolder();
+
+    // use temp folder if tsfolder is empty
+    if(tsfile.empty()) {
+      XVDR::ClientInterface::GetTempFolder(tsfile);
+    }
+
+    XVDR::ClientInterface::TrimPath(tsfile, true);
+    tsfile += "xvdr-timeshift.dat";
+
+    buf = (s.TSBufferSizeHDD() > 0) ? PacketBuffer::create(s.TSBufferSizeHDD() * 1024 * 1024, tsfile) : NULL;
+    if(buf != NULL) {
+      XBMC->Log(LOG_NOTICE, "doing timeshift on hdd at '%s' using %f Mb", tsfile.c_str(), s.TSBufferSizeHDD());
+    }
+  }
+
+  return buf;
+}
+
 extern "C" {
 
 /***********************************************************
@@ -131,6 +213,17 @@ ADDON_STATUS ADDON_Create(void* hdl, void* props)
   mClient->ChannelFilter(s.FTAChannels(), s.NativeLangOnly(), s.vcaids);
   mClient->SetUpdateChannels(s.UpdateChannels());
 
+  // keep the recordings list and the guide in the user profile
+  std::string userpath = ((PVR_PROPERTIES*)props)->strUserPath;
+  XVDR::ClientInterface::TrimPath(userpath, true);
+  mClient->SetRecordingIndex(userpath + "recordings.idx");
+  mClient->SetEpgStore(userpath + "epg");
+  mClient->SetChannelCache(userpath + "channels.cache");
+
+  // hours of the guide kept loaded
+  static const int prefetch[] = { 0, 6, 12, 24, 48 };
+  mClient->SetEpgPrefetch(prefetch[s.EpgPrefetch()]);
+
   PVR_MENUHOOK hook;
 
   // add menuhook if scanning is supported
@@ -152,11 +245,15 @@ ADDON_STATUS ADDON_GetStatus()
 void ADDON_Destroy()
 {
   XVDR::MutexLock lock(&addonMutex);
+  delete mDemuxer;
+  delete mDemuxerPool;
   delete mClient;
   delete GUI;
   delete PVR;
   delete XBMC;
 
+  mDemuxer = NULL;
+  mDemuxerPool = NULL;
   mClient = NULL;
   GUI = NULL;
   PVR = NULL;
@@ -189,6 +286,13 @@ ADDON_STATUS ADDON_SetSetting(const char *settingName, const void *settingValue)
 
   s.checkValues();
 
+  // pooled stream connections were set up with the old values
+  mClient->Lock();
+  delete mDemuxerPool;
+  mDemuxerPool = NULL;
+  mDemuxerStale = (mDemuxer != NULL);
+  mClient->Unlock();
+
   mClient->SetTimeout(s.ConnectTimeout() * 1000);
   mClient->SetCompressionLevel(s.Compression() * 3);
   mClient->SetAudioType(s.AudioType());
@@ -523,50 +627,21 @@ bool OpenLiveStream(const PVR_CHANNEL &channel)
 {
   mClient->Lock();
 
-  if (mDemuxer)
-  {
-    mDemuxer->Close();
-    delete mDemuxer;
-  }
-
-  cXBMCSettings& s = cXBMCSettings::GetInstance();
-  PacketBuffer* buf = NULL;
-
-  // simple timeshift
-  if(s.TSMethod() == 0) {
-    XBMC->Log(LOG_NOTICE, "doing simple server-side timeshift");
-  }
-
-  // full-timeshift (ram)
-  else if(s.TSMethod() == 1) {
-    buf = (s.TSBufferSize() > 0) ? PacketBuffer::create(s.TSBufferSize() * 1024 * 1024) : NULL;
-    if(buf != NULL) {
-      XBMC->Log(LOG_NOTICE, "doing timeshift in memory using %f Mb RAM", s.TSBufferSize());
-    }
-  }
-
-  // full-timeshift (hdd)
-  else if(s.TSMethod() == 2) {
-    std::string tsfile = s.TSFolder();
-
-    // use temp folder if tsfolder is empty
-    if(tsfile.empty()) {
-      XVDR::ClientInterface::GetTempFolder(tsfile);
-    }
+  ReleaseDemuxer();
 
-    XVDR::ClientInterface::TrimPath(tsfile, true);
-    tsfile += "xvdr-timeshift.dat";
+  // take over the pooled stream connection
+  mDemuxer = mDemuxerPool;
+  mDemuxerPool = NULL;
 
-    buf = (s.TSBufferSizeHDD() > 0) ? PacketBuffer::create(s.TSBufferSizeHDD() * 1024 * 1024, tsfile) : NULL;
-    if(buf != NULL) {
-      XBMC->Log(LOG_NOTICE, "doing timeshift on hdd at '%s' using %f Mb", tsfile.c_str(), s.TSBufferSizeHDD());
-    }
-  }
+  if (mDemuxer == NULL)
+    mDemuxer = new Demux(mClient, CreateTimeshiftBuffer());
 
-  mDemuxer = new Demux(mClient, buf);
   mDemuxer->SetTimeout(cXBMCSettings::GetInstance().ConnectTimeout() * 1000);
   mDemuxer->SetAudioType(cXBMCSettings::GetInstance().AudioType());
   mDemuxer->SetPriority(priotable[cXBMCSettings::GetInstance().Priority()]);
+  mDemuxer->SetStreamFilter(StreamFilter());
+  mDemuxer->SetCatchUp(cXBMCSettings::GetInstance().LiveCatchUp() * 1000);
+  mDemuxer->SetRequestWindow(8 << cXBMCSettings::GetInstance().RequestWindow());
 
   if(!channel.bIsRadio) {
     mDemuxer->SetStartWithIFrame(cXBMCSettings::GetInstance().StartWithIFrame());
@@ -575,7 +650,10 @@ bool OpenLiveStream(const PVR_CHANNEL &channel)
   Demux::SwitchStatus status = mDemuxer->OpenChannel(cXBMCSettings::GetInstance().Hostname(), channel.iUniqueId);
 
   if (status == Demux::SC_OK)
+  {
     CurrentChannel = channel.iChannelNumber;
+    mClient->ChannelWatched(channel.iUniqueId);
+  }
   else
     ChannelNotification(status);
 
@@ -588,12 +666,8 @@ void CloseLiveStream(void)
 {
   mClient->Lock();
 
-  if (mDemuxer)
-  {
-    mDemuxer->Close();
-    delete mDemuxer;
-    mDemuxer = NULL;
-  }
+  // return the stream connection to the pool
+  ReleaseDemuxer();
 
   mClient->Unlock();
 }
@@ -613,7 +687,7 @@ void DemuxAbort(void)
   if (!mDemuxer)
     return;
 
-  mDemuxer->Abort();
+  mDemuxer->Interrupt();
 }
 
 void DemuxReset(void)
@@ -661,8 +735,10 @@ bool SwitchChannel(const PVR_CHANNEL &channel)
 
   Demux::SwitchStatus status = mDemuxer->SwitchChannel(channel.iUniqueId);
 
-  if(status == Demux::SC_OK)
+  if(status == Demux::SC_OK) {
     CurrentChannel = channel.iChannelNumber;
+    mClient->ChannelWatched(channel.iUniqueId);
+  }
   else
     ChannelNotification(status);
 
@@ -701,6 +777,7 @@ bool OpenRecordedStream(const PVR_RECORDING &recording)
 
   mClient->CloseRecording();
   mClient->SetTimeout(cXBMCSettings::GetInstance().ConnectTimeout() * 1000);
+  mClient->SetRecordingStripes(cXBMCSettings::GetInstance().RecordingSessions() + 1);
 
   return mClient->OpenRecording(recording.strRecordingId);
 }
@@ -256,6 +256,28 @@ void cXBMCClient::TransferRecordingEntry(const RecordingEntry& rec)
   PVR->TransferRecordingEntry(m_handle, &pvrrec);
 }
 
+void cXBMCClient::TransferEpgEntries(const std::vector<EpgItemRef>& tags)
+{
+  EPG_TAG pvrepg;
+
+  for(std::vector<EpgItemRef>::const_iterator i = tags.begin(); i != tags.end(); i++)
+  {
+    pvrepg << *i;
+    PVR->TransferEpgEntry(m_handle, &pvrepg);
+  }
+}
+
+void cXBMCClient::TransferRecordingEntries(const std::vector<RecordingEntryRef>& recs)
+{
+  PVR_RECORDING pvrrec;
+
+  for(std::vector<RecordingEntryRef>::const_iterator i = recs.begin(); i != recs.end(); i++)
+  {
+    pvrrec << *i;
+    PVR->TransferRecordingEntry(m_handle, &pvrrec);
+  }
+}
+
 void cXBMCClient::TransferChannelGroup(const ChannelGroup& group)
 {
   PVR_CHANNEL_GROUP pvrgroup;
@@ -390,6 +412,24 @@ EPG_TAG& operator<< (EPG_TAG& lhs, const EpgItem& rhs) {
 	return lhs;
 }
 
+EPG_TAG& operator<< (EPG_TAG& lhs, const EpgItemRef& rhs) {
+	memset(&lhs, 0, sizeof(lhs));
+
+	lhs.endTime = rhs.EndTime;
+	lhs.iChannelNumber = rhs.UID;
+	lhs.iGenreSubType = rhs.GenreSubType;
+	lhs.iGenreType = rhs.GenreType;
+	lhs.iParentalRating = rhs.ParentalRating;
+	lhs.iUniqueBroadcastId = rhs.BroadcastID;
+	lhs.startTime = rhs.StartTime;
+
+	lhs.strPlot = rhs.Plot;
+	lhs.strPlotOutline = rhs.PlotOutline;
+	lhs.strTitle = rhs.Title;
+
+	return lhs;
+}
+
 Timer& operator<< (Timer& lhs, const PVR_TIMER& rhs) {
 	lhs.IsRepeating = rhs.bIsRepeating;
 	lhs.EndTime = rhs.endTime + rhs.iMarginEnd * 60;
@@ -488,6 +528,27 @@ PVR_RECORDING& operator<< (PVR_RECORDING& lhs, const RecordingEntry& rhs) {
 	return lhs;
 }
 
+PVR_RECORDING& operator<< (PVR_RECORDING& lhs, const RecordingEntryRef& rhs) {
+	memset(&lhs, 0, sizeof(lhs));
+
+	lhs.iDuration = rhs.Duration;
+	lhs.iGenreSubType = rhs.GenreSubType;
+	lhs.iGenreType = rhs.GenreType;
+	lhs.iLifetime = rhs.LifeTime;
+	lhs.iPlayCount = rhs.PlayCount;
+	lhs.iPriority = rhs.Priority;
+	lhs.recordingTime = rhs.Time;
+	strncpy(lhs.strChannelName, rhs.ChannelName, sizeof(lhs.strChannelName));
+	strncpy(lhs.strDirectory, rhs.Directory, sizeof(lhs.strDirectory));
+	strncpy(lhs.strPlot, rhs.Plot, sizeof(lhs.strPlot));
+	strncpy(lhs.strPlotOutline, rhs.PlotOutline, sizeof(lhs.strPlotOutline));
+	strncpy(lhs.strRecordingId, rhs.Id, sizeof(lhs.strRecordingId));
+	strncpy(lhs.strTitle, rhs.Title, sizeof(lhs.strTitle));
+	lhs.strStreamURL[0] = 0;
+
+	return lhs;
+}
+
 PVR_CHANNEL_GROUP& operator<< (PVR_CHANNEL_GROUP& lhs, const ChannelGroup& rhs) {
 	memset(&lhs, 0, sizeof(lhs));
 
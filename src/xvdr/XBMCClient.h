@@ -80,6 +80,10 @@ public:
 
   void TransferRecordingEntry(const XVDR::RecordingEntry& rec);
 
+  void TransferEpgEntries(const std::vector<XVDR::EpgItemRef>& tags);
+
+  void TransferRecordingEntries(const std::vector<XVDR::RecordingEntryRef>& recs);
+
   void TransferChannelGroup(const XVDR::ChannelGroup& group);
 
   void TransferChannelGroupMember(const XVDR::ChannelGroupMember& member);
@@ -120,6 +124,8 @@ PVR_CHANNEL& operator<< (PVR_CHANNEL& lhs, const XVDR::Channel& rhs);
 
 EPG_TAG& operator<< (EPG_TAG& lhs, const XVDR::EpgItem& rhs);
 
+EPG_TAG& operator<< (EPG_TAG& lhs, const XVDR::EpgItemRef& rhs);
+
 XVDR::Timer& operator<< (XVDR::Timer& lhs, const PVR_TIMER& rhs);
 
 PVR_TIMER& operator<< (PVR_TIMER& lhs, const XVDR::Timer& rhs);
@@ -128,6 +134,8 @@ XVDR::RecordingEntry& operator<< (XVDR::RecordingEntry& lhs, const PVR_RECORDING
 
 PVR_RECORDING& operator<< (PVR_RECORDING& lhs, const XVDR::RecordingEntry& rhs);
 
+PVR_RECORDING& operator<< (PVR_RECORDING& lhs, const XVDR::RecordingEntryRef& rhs);
+
 PVR_CHANNEL_GROUP& operator<< (PVR_CHANNEL_GROUP& lhs, const XVDR::ChannelGroup& rhs);
 
 PVR_CHANNEL_GROUP_MEMBER& operator<< (PVR_CHANNEL_GROUP_MEMBER& lhs, const XVDR::ChannelGroupMember& rhs);
@@ -92,6 +92,17 @@ void cXBMCSettings::checkValues()
   // check priority setting (and set a sane value)
   if(Priority() > 21)
     Priority.set(10);
+
+  // 8 << n packets
+  if(RequestWindow() < 0 || RequestWindow() > 4)
+    RequestWindow.set(2);
+
+  if(RecordingSessions() < 0 || RecordingSessions() > 3)
+    RecordingSessions.set(0);
+
+  // 0, 6, 12, 24, 48 hours
+  if(EpgPrefetch() < 0 || EpgPrefetch() > 4)
+    EpgPrefetch.set(0);
 }
 
 void cXBMCSettings::load()
@@ -132,6 +132,8 @@ public:
   cXBMCConfigParameter<int> AudioType;
   cXBMCConfigParameter<int> UpdateChannels;
   cXBMCConfigParameter<bool> StartWithIFrame;
+  cXBMCConfigParameter<int> StreamFilter;
+  cXBMCConfigParameter<int> LiveCatchUp;
   cXBMCConfigParameter<bool> FTAChannels;
   cXBMCConfigParameter<bool> NativeLangOnly;
   cXBMCConfigParameter<bool> EncryptedChannels;
@@ -141,6 +143,9 @@ public:
   cXBMCConfigParameter<float> TSBufferSizeHDD;
   cXBMCConfigParameter<int> TSMethod;
   cXBMCConfigParameter<std::string> TSFolder;
+  cXBMCConfigParameter<int> RequestWindow;
+  cXBMCConfigParameter<int> RecordingSessions;
+  cXBMCConfigParameter<int> EpgPrefetch;
   std::vector<int> vcaids;
 
 protected:
@@ -155,6 +160,8 @@ protected:
   AudioType("audiotype", 0),
   UpdateChannels("updatechannels", 3),
   StartWithIFrame("iframe", false),
+  StreamFilter("streamfilter", 0),
+  LiveCatchUp("livecatchup", 0),
   FTAChannels("ftachannels", true),
   NativeLangOnly("nativelangonly", false),
   EncryptedChannels("encryptedchannels", true),
@@ -163,7 +170,10 @@ protected:
   TSBufferSize("tsbuffersize"),
   TSMethod("tsmethod"),
   TSBufferSizeHDD("tsbuffersizehdd"),
-  TSFolder("tsfolder")
+  TSFolder("tsfolder"),
+  RequestWindow("requestwindow", 2),
+  RecordingSessions("recordingsessions", 0),
+  EpgPrefetch("epgprefetch", 0)
   {}
 
 private: